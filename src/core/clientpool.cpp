@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "clientpool.h"
+
+#include <new>
+
+ClientPool::~ClientPool()
+{
+    for (quint32 slot = 0; slot < m_used.size(); ++slot) {
+        if (m_used[slot])
+            at(slot)->~ResourceClient();
+    }
+}
+
+ResourceClient* ClientPool::allocate()
+{
+    if (m_free.empty()) {
+        const quint32 first = quint32(capacity());
+        m_chunks.push_back(std::make_unique<Chunk>());
+        m_used.resize(first + ChunkSize, false);
+
+        // lowest slot on top, records are handed out in address order
+        for (quint32 slot = first + ChunkSize; slot > first; --slot)
+            m_free.push_back(slot - 1);
+    }
+
+    const quint32 slot = m_free.back();
+    m_free.pop_back();
+    m_used[slot] = true;
+    ++m_size;
+
+    return new (at(slot)) ResourceClient(slot);
+}
+
+void ClientPool::release(ResourceClient* client)
+{
+    if (!client)
+        return;
+
+    const quint32 slot = client->slot();
+    Q_ASSERT(slot < m_used.size() && m_used[slot] && at(slot) == client);
+
+    client->~ResourceClient();
+    m_used[slot] = false;
+    m_free.push_back(slot);
+    --m_size;
+}
+
+qsizetype ClientPool::bytesReserved() const
+{
+    return qsizetype(m_chunks.size()) * qsizetype(sizeof(Chunk) + sizeof(std::unique_ptr<Chunk>))
+        + qsizetype(m_free.capacity() * sizeof(quint32))
+        + qsizetype(m_used.capacity() / 8);
+}
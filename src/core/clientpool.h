@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CLIENTPOOL_H
+#define CLIENTPOOL_H
+
+#include "resourceclient.h"
+
+#include <QtGlobal>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Slab of ResourceClient records. Records live in fixed-size chunks that
+ * never move, so pointers and slots stay valid until release(). Freed
+ * slots are reused before the pool grows by another chunk.
+ */
+class ClientPool {
+public:
+    static constexpr quint32 ChunkSize = 64;
+
+    ClientPool() = default;
+    ~ClientPool();
+    Q_DISABLE_COPY_MOVE(ClientPool)
+
+    ResourceClient* allocate();
+    void release(ResourceClient* client);
+
+    qsizetype size() const { return m_size; }
+    qsizetype capacity() const { return qsizetype(m_chunks.size()) * ChunkSize; }
+
+    // memory held by the pool itself, strings of the records not included
+    qsizetype bytesReserved() const;
+
+private:
+    struct Chunk {
+        alignas(ResourceClient) unsigned char storage[ChunkSize * sizeof(ResourceClient)];
+    };
+
+    ResourceClient* at(quint32 slot) const
+    {
+        return reinterpret_cast<ResourceClient*>(m_chunks[slot / ChunkSize]->storage) + slot % ChunkSize;
+    }
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    std::vector<quint32> m_free;
+    std::vector<bool> m_used;
+    qsizetype m_size = 0;
+};
+
+#endif // CLIENTPOOL_H
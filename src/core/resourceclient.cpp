@@ -19,92 +19,41 @@
 
 #include "resourceclient.h"
 
-ResourceClient::ResourceClient(
-    QObject* parent)
-    : QObject(parent)
+ResourceClient::ResourceClient(quint32 slot)
+    : m_granted(0)
+    , m_mandatory(0)
+    , m_optional(0)
+    , m_share(0)
+    , m_mask(0)
+    , m_priority(0)
     , m_clientID(-1)
-    , m_clientReqqno(0)
+    , m_classId(0)
+    , m_clientType(0)
+    , m_slot(slot)
+    , m_channel(0)
+    , m_recentRequests {}
+    , m_nextRecent(0)
 {
 }
 
-void ResourceClient::setPriority(int priority)
+void ResourceClient::setClientClass(const QString& klass, const QString& mode)
 {
-    m_priority = priority;
+    m_class = klass;
+    m_mode = mode;
 }
 
-bool ResourceClient::hasResource(const QString& resource) const
+QString ResourceClient::objectPath() const
 {
-    return m_resources.contains(resource);
+    return QStringLiteral("/org/maemo/resource/client%1").arg(m_clientID);
 }
 
-void ResourceClient::addResource(const QString& resource)
+void ResourceClient::setResourceSet(ResourcePolicy::ResourceMask mandatory,
+    ResourcePolicy::ResourceMask optional,
+    ResourcePolicy::ResourceMask share,
+    ResourcePolicy::ResourceMask mask)
 {
-    if (m_resources.contains(resource))
-        return;
-
-    m_resources.append(resource);
-}
-
-void ResourceClient::removeResource(const QString& resource)
-{
-    m_resources.removeAll(resource);
-}
-
-/* notifications */
-
-void ResourceClient::notifyGranted(const QString& resource)
-{
-    emit notify(QStringLiteral("granted"), resource);
-}
-
-void ResourceClient::notifyLost(const QString& resource)
-{
-    emit notify(QStringLiteral("lost"), resource);
-}
-
-void ResourceClient::notifyDenied(const QString& resource)
-{
-    emit notify(QStringLiteral("denied"), resource);
-}
-
-int ResourceClient::clientType() const
-{
-    return m_clientType;
-}
-
-void ResourceClient::setClientType(int newClientType)
-{
-    if (m_clientType == newClientType)
-        return;
-    m_clientType = newClientType;
-    emit clientTypeChanged();
-}
-
-uint ResourceClient::clientID() const
-{
-    return m_clientID;
-}
-
-void ResourceClient::setClientID(uint newClientID)
-{
-    m_clientID = newClientID;
-}
-
-uint ResourceClient::clientReqqno()
-{
-    m_clientReqqno++;
-    return m_clientReqqno;
-}
-
-QString ResourceClient::serviceName() const
-{
-    return m_serviceName;
-}
-
-void ResourceClient::setServiceName(const QString& newServiceName)
-{
-    if (m_serviceName == newServiceName)
-        return;
-    m_serviceName = newServiceName;
-    emit serviceNameChanged();
+    m_mandatory = mandatory;
+    m_optional = optional;
+    m_share = share;
+    m_mask = mask;
 }
@@ -20,78 +20,113 @@
 #ifndef RESOURCECLIENT_H
 #define RESOURCECLIENT_H
 
-#include <QObject>
+#include "resourcetypes.h"
+
 #include <QString>
-#include <QStringList>
-#include <qdbuscontext.h>
+
+#include <algorithm>
+#include <array>
 
 /**
- * Represents one OHM client.
- * One client == one D-Bus connection (service name).
+ * Represents one resource set, as registered by a libresource client.
+ * A process can register several sets over one D-Bus connection.
+ *
+ * Plain record kept in the ClientPool of the ResourceManager, which also
+ * reports its notifications.
  */
-class ResourceClient : public QObject {
-    Q_OBJECT
-    Q_PROPERTY(int clientType READ clientType WRITE setClientType NOTIFY clientTypeChanged FINAL)
-    Q_PROPERTY(uint clientID READ clientID WRITE setClientID NOTIFY clientIDChanged FINAL)
-    Q_PROPERTY(uint clientReqqno READ clientReqqno FINAL)
-    Q_PROPERTY(QString serviceName READ serviceName WRITE setServiceName NOTIFY serviceNameChanged FINAL)
-    Q_PROPERTY(QString objectPath READ objectPath WRITE setObjectPath NOTIFY objectPathChanged FINAL)
-
+class ResourceClient {
 public:
-    explicit ResourceClient(QObject* parent = nullptr);
+    enum Event {
+        Granted,
+        Lost,
+        Denied
+    };
+
+    explicit ResourceClient(quint32 slot = 0);
+
+    // slot in the ClientPool, stable for the lifetime of the record
+    quint32 slot() const { return m_slot; }
 
     // identity
-    void setPriority(int priority);
+    void setPriority(int priority) { m_priority = priority; }
     int priority() const { return m_priority; }
 
-    QString objectPath() const { return m_objectPath; }
-    void setObjectPath(const QString& path) { m_objectPath = path; }
-
-    // resources
-    const QStringList& resources() const { return m_resources; }
-    bool hasResource(const QString& resource) const;
+    // application class and mode as passed to register(), the class id
+    // indexes the compiled preemption rules
+    void setClientClass(const QString& klass, const QString& mode);
+    QString clientClass() const { return m_class; }
+    QString mode() const { return m_mode; }
+    quint8 classId() const { return m_classId; }
+    void setClassId(quint8 classId) { m_classId = classId; }
+
+    // derived from the id, not stored
+    QString objectPath() const;
+
+    // connection the set is served on, set by the adaptor exporting it
+    quint32 channel() const { return m_channel; }
+    void setChannel(quint32 channel) { m_channel = channel; }
+
+    // resource set as passed to register()
+    void setResourceSet(ResourcePolicy::ResourceMask mandatory,
+        ResourcePolicy::ResourceMask optional,
+        ResourcePolicy::ResourceMask share,
+        ResourcePolicy::ResourceMask mask);
+    ResourcePolicy::ResourceMask mandatory() const { return m_mandatory; }
+    ResourcePolicy::ResourceMask optional() const { return m_optional; }
+    ResourcePolicy::ResourceMask share() const { return m_share; }
+    ResourcePolicy::ResourceMask mask() const { return m_mask; }
+
+    // currently granted resources
+    ResourcePolicy::ResourceMask resources() const { return m_granted; }
+    bool hasResource(ResourcePolicy::ResourceAtom resource) const { return m_granted & ResourcePolicy::maskOf(resource); }
+    bool hasResources(ResourcePolicy::ResourceMask resources) const { return (m_granted & resources) == resources; }
 
     // resource lifecycle (called by ResourceManager)
-    void addResource(const QString& resource);
-    void removeResource(const QString& resource);
-
-    // notifications (mapped to DBus in adaptor)
-    void notifyGranted(const QString& resource);
-    void notifyLost(const QString& resource);
-    void notifyDenied(const QString& resource);
-
-    int clientType() const;
-    void setClientType(int newClientType);
-
-    uint clientID() const;
-    void setClientID(uint newClientID);
-
-    uint clientReqqno();
-
-    QString serviceName() const;
-    void setServiceName(const QString& newServiceName);
-
-signals:
-    void notify(const QString& event,
-        const QString& resource);
-
-    void clientTypeChanged();
-    void clientIDChanged();
-    void clientReqqnoChanged();
-    void objectPathChanged();
-
-    void status(int rtype, uint id, uint reqno, int status);
-
-    void serviceNameChanged();
+    void addResources(ResourcePolicy::ResourceMask resources) { m_granted |= resources; }
+    void removeResources(ResourcePolicy::ResourceMask resources) { m_granted &= ~resources; }
+
+    int clientType() const { return m_clientType; }
+    void setClientType(int clientType) { m_clientType = clientType; }
+
+    uint clientID() const { return m_clientID; }
+    void setClientID(uint clientID) { m_clientID = clientID; }
+
+    QString serviceName() const { return m_serviceName; }
+    void setServiceName(const QString& serviceName) { m_serviceName = serviceName; }
+
+    // reqnos of the last requests answered, libresource retries with the
+    // same reqno after a timeout; 0 is never remembered
+    bool isRecentRequest(uint reqno) const
+    {
+        return reqno && std::find(m_recentRequests.begin(), m_recentRequests.end(), reqno) != m_recentRequests.end();
+    }
+    void rememberRequest(uint reqno)
+    {
+        m_recentRequests[m_nextRecent] = reqno;
+        m_nextRecent = (m_nextRecent + 1) % RecentRequests;
+    }
 
 private:
+    static constexpr int RecentRequests = 4;
+
+    // hot fields first, arbitration only reads these
+    ResourcePolicy::ResourceMask m_granted;
+    ResourcePolicy::ResourceMask m_mandatory;
+    ResourcePolicy::ResourceMask m_optional;
+    ResourcePolicy::ResourceMask m_share;
+    ResourcePolicy::ResourceMask m_mask;
     int m_priority;
-    QStringList m_resources;
-    QString m_objectPath;
-    int m_clientType;
     uint m_clientID;
-    uint m_clientReqqno;
+    quint8 m_classId;
+    int m_clientType;
+    quint32 m_slot;
+    quint32 m_channel;
+    std::array<uint, RecentRequests> m_recentRequests;
+    quint8 m_nextRecent;
+
     QString m_serviceName;
+    QString m_class;
+    QString m_mode;
 };
 
 #endif // RESOURCECLIENT_H
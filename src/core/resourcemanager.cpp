@@ -21,149 +21,617 @@
 #include "resourceclient.h"
 #include <policy/prioritypolicy.h>
 #include <policy/securitypolicy.h>
+#include <util/config.h>
 #include <util/logger.h>
 
-#include <QDBusConnection>
 #include <QDBusMessage>
+#include <QTimer>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <utility>
 
 ResourceManager::ResourceManager(QObject* parent)
     : QObject(parent)
-    , m_security(new SecurityPolicy(this))
-    , m_priority(new PriorityPolicy(this))
+    , m_owners {}
+    , m_ownedMask(0)
+    , m_sharedMask(0)
+    , m_heldSince {}
+    , m_retryTimer(new QTimer(this))
+    , m_lastTicket(0)
+    , m_lastClientId(0)
+    , m_config(new Config(this))
+    , m_security(new SecurityPolicy(m_config, this))
+    , m_priority(new PriorityPolicy(m_config, this))
 {
+    connect(m_config, &Config::reloaded, this, &ResourceManager::reclassifyClients);
+    m_clock.start();
+
+    m_retryTimer->setSingleShot(true);
+    m_retryTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_retryTimer, &QTimer::timeout, this, &ResourceManager::retryDamped);
 }
 
 ResourceClient* ResourceManager::createClient(const QDBusMessage& message, int priority)
 {
-    ResourceClient* client = new ResourceClient(this);
+    return createClient(message.service(), priority);
+}
+
+/**
+ * @service is the bus name of the peer, or the connection name for
+ * peer-to-peer clients.
+ */
+ResourceClient* ResourceManager::createClient(const QString& service, int priority)
+{
+    const uint id = ++m_lastClientId;
+    m_store.setLastClientId(id);
 
-    m_clients.append(client);
+    // libresource clients register with 0 unless they ask for something else
+    ResourceClient* client = addClient(id, service, priority ? priority : m_config->snapshot()->defaultClientPriority);
 
-    qCDebug(lcResourceDaemonCoreLog) << "Client created:" << message.service();
-    qCDebug(lcResourceDaemonCoreLog) << "priority:" << QString::number(priority);
+    qCDebug(lcResourceDaemonCoreLog) << "Client created:" << service;
+    qCDebug(lcResourceDaemonCoreLog) << "priority:" << QString::number(client->priority());
 
     return client;
 }
 
+/**
+ * Write @client to the ownership store once its resource set is known.
+ */
+void ResourceManager::persistClient(const ResourceClient* client)
+{
+    if (!m_store.isOpen())
+        return;
+
+    OwnershipStore::Entry entry;
+    entry.id = client->clientID();
+    entry.priority = client->priority();
+    entry.type = client->clientType();
+    entry.mandatory = client->mandatory();
+    entry.optional = client->optional();
+    entry.share = client->share();
+    entry.mask = client->mask();
+    entry.granted = client->resources();
+    entry.service = client->serviceName();
+    entry.klass = client->clientClass();
+    entry.mode = client->mode();
+    m_store.store(entry);
+}
+
+/**
+ * Bring back the clients of a previous run whose peer is still in
+ * @liveServices, with the resources they held. Only a set that loses a
+ * resource another one claimed first is notified. Entries of vanished
+ * peers are dropped.
+ */
+QList<ResourceClient*> ResourceManager::restoreClients(const QSet<QString>& liveServices)
+{
+    QList<ResourceClient*> restored;
+
+    m_lastClientId = std::max(m_lastClientId, m_store.lastClientId());
+
+    const QList<OwnershipStore::Entry> entries = m_store.entries();
+    for (const OwnershipStore::Entry& entry : entries) {
+        if (!liveServices.contains(entry.service) || m_clientsById.contains(entry.id)) {
+            m_store.remove(entry.id);
+            continue;
+        }
+
+        m_lastClientId = std::max(m_lastClientId, entry.id);
+
+        ResourceClient* client = addClient(entry.id, entry.service, entry.priority);
+        client->setClientType(entry.type);
+        client->setResourceSet(entry.mandatory, entry.optional, entry.share, entry.mask);
+        setClientClass(client, entry.klass, entry.mode);
+
+        // a resource claimed twice stays with the first claimant
+        const ResourcePolicy::ResourceMask keep = (entry.granted & ~m_ownedMask)
+            | (entry.granted & m_sharedMask & client->share());
+        attach(client, keep);
+        m_store.setGranted(entry.id, keep);
+
+        m_recorder.record(FlightRecorder::Restore, entry.id, 0, keep);
+        restored.append(client);
+
+        if (const ResourcePolicy::ResourceMask lost = entry.granted & ~keep)
+            emit clientNotified(client, ResourceClient::Lost, lost);
+    }
+
+    m_store.setLastClientId(m_lastClientId);
+
+    qCDebug(lcResourceDaemonCoreLog) << "Restored" << restored.size() << "of" << entries.size() << "resource sets";
+
+    return restored;
+}
+
 void ResourceManager::destroyClient(ResourceClient* client)
 {
     if (!client)
         return;
 
-    qCDebug(lcResourceDaemonCoreLog) << "Client destroyed" << client->objectPath();
+    auto it = m_clientsByService.find(client->serviceName());
+    if (it != m_clientsByService.end()) {
+        it->removeOne(client);
+        if (it->isEmpty())
+            m_clientsByService.erase(it);
+    }
 
-    releaseAll(client);
-    m_clients.removeAll(client);
-    client->deleteLater();
+    removeClient(client);
+}
+
+int ResourceManager::destroyClientsForService(const QString& service)
+{
+    // take the whole bucket, cost is O(clients of this service)
+    const QList<ResourceClient*> clients = m_clientsByService.take(service);
+
+    for (ResourceClient* client : clients) {
+        m_recorder.record(FlightRecorder::Reap, client->clientID(), 0, client->resources());
+        removeClient(client);
+    }
+
+    qCDebug(lcResourceDaemonCoreLog) << "Reaped" << clients.size() << "clients of" << service;
+
+    return clients.size();
 }
 
-void ResourceManager::requestResources(ResourceClient* client,
-    const QStringList& resources)
+void ResourceManager::setClientClass(ResourceClient* client, const QString& klass, const QString& mode)
+{
+    client->setClientClass(klass, mode);
+    client->setClassId(m_config->snapshot()->preemptionRules.classId(klass));
+}
+
+/**
+ * The mandatory part of @resources is all or nothing: it is decided as a
+ * whole against the current owners, and only if every resource of it can
+ * be had are owners preempted and the set granted. Optional resources are
+ * added best effort afterwards.
+ */
+ResourcePolicy::ResourceMask ResourceManager::requestResources(ResourceClient* client,
+    ResourcePolicy::ResourceMask resources)
+{
+    if (!client)
+        return 0;
+
+    // already owned resources need no decision
+    resources &= ~client->resources();
+
+    const ResourcePolicy::ResourceMask mandatory = resources & client->mandatory();
+    const ResourcePolicy::ResourceMask optional = resources & ~mandatory;
+
+    ResourcePolicy::ResourceMask granted = 0;
+    ResourcePolicy::ResourceMask denied = 0;
+
+    const Decision required = decide(client, mandatory);
+    int suppressed = required.suppressed;
+    qint64 retryAt = required.retryAt;
+    if (required.denied) {
+        // nothing changes, the client waits for the whole set
+        denied = mandatory | optional;
+    } else {
+        granted = commit(client, required);
+
+        const Decision extra = decide(client, optional);
+        granted |= commit(client, extra);
+        denied = extra.denied;
+        suppressed += extra.suppressed;
+        retryAt = extra.retryAt;
+    }
+
+    if (suppressed)
+        m_stats.increment(Statistics::SuppressedFlips, suppressed);
+
+    if (granted)
+        grant(client, granted);
+
+    if (denied) {
+        emit clientNotified(client, ResourceClient::Denied, denied);
+        m_stats.increment(Statistics::Denials);
+        m_recorder.record(FlightRecorder::Deny, client->clientID(), 0, denied);
+    }
+
+    // denied resources are handed over on release instead of being re-requested;
+    // a damped request is decided again once the damping ends
+    dequeue(client, resources & ~denied);
+    enqueue(client, denied);
+    if (denied && retryAt)
+        scheduleRetry(client, retryAt);
+
+    return client->resources();
+}
+
+void ResourceManager::releaseAll(ResourceClient* client)
 {
     if (!client)
         return;
 
-    for (const QString& res : resources) {
+    // a released client no longer waits for anything either
+    dequeue(client, ~ResourcePolicy::ResourceMask(0));
 
-        auto* owner = m_resourceOwners.value(res, nullptr);
+    // shared resources only become free with their last holder
+    const ResourcePolicy::ResourceMask freed = removeHolder(client, client->resources());
 
-        // free resource
-        if (!owner) {
-            grant(client, res);
-            continue;
+    handOff(freed);
+}
+
+ResourceClient* ResourceManager::clientByPath(const QString& path) const
+{
+    static const QLatin1String prefix("/org/maemo/resource/client");
+    if (!path.startsWith(prefix))
+        return nullptr;
+
+    bool ok = false;
+    const uint id = QStringView(path).mid(prefix.size()).toUInt(&ok);
+    return ok ? clientById(id) : nullptr;
+}
+
+bool ResourceManager::isOwner(ResourcePolicy::ResourceMask resources,
+    const ResourceClient* client) const
+{
+    return client && resources && client->hasResources(resources);
+}
+
+/* private */
+
+/**
+ * What @client would get of @resources right now, nothing is changed.
+ * One preemption decision per current owner, covering all its contested
+ * bits; a resource is only taken if every one of its holders yields.
+ */
+ResourceManager::Decision ResourceManager::decide(ResourceClient* client,
+    ResourcePolicy::ResourceMask resources) const
+{
+    Decision decision;
+
+    const ResourcePolicy::ResourceMask available = resources & ~m_ownedMask;
+    // held in shared mode and the client is willing to share: join the holders
+    decision.joinable = resources & m_sharedMask & client->share();
+    const ResourcePolicy::ResourceMask contested = resources & m_ownedMask & ~decision.joinable;
+
+    const bool preemption = m_config->snapshot()->enablePreemption;
+    QVarLengthArray<ResourceClient*, 4> decided;
+
+    for (ResourcePolicy::ResourceMask bits = contested; bits; bits &= bits - 1) {
+        const int atom = std::countr_zero(bits);
+        for (ResourceClient* owner : m_owners[atom].clients) {
+            if (!decided.contains(owner)) {
+                decided.append(owner);
+                const ResourcePolicy::ResourceMask held = contested & owner->resources();
+                if (preemption && m_priority->canPreempt(client, owner, held)) {
+                    if (const qint64 until = dampedUntil(client, owner, held)) {
+                        ++decision.suppressed;
+                        decision.retryAt = std::max(decision.retryAt, until);
+                    } else {
+                        decision.yielding.append(owner);
+                    }
+                }
+            }
+            if (!decision.yielding.contains(owner))
+                decision.denied |= ResourcePolicy::maskOf(atom);
         }
+    }
+
+    decision.taken = contested & ~decision.denied;
+    decision.granted = available | decision.joinable | decision.taken;
 
-        // already owns
-        if (owner == client)
+    return decision;
+}
+
+/**
+ * Preempt the owners @decision takes resources from.
+ * Returns the resources to grant to @client.
+ */
+ResourcePolicy::ResourceMask ResourceManager::commit(ResourceClient* client, const Decision& decision)
+{
+    for (ResourceClient* owner : decision.yielding) {
+        const ResourcePolicy::ResourceMask lost = decision.taken & owner->resources();
+        if (!lost)
             continue;
 
-        // PREEMPTION DECISION
-        if (m_priority->canPreempt(client, owner, res)) {
-            preempt(owner, client, res);
-        } else {
-            client->notifyDenied(res);
+        preempt(owner, client, lost);
+        notePreemption(client, owner);
+        m_stats.increment(Statistics::Preemptions);
+        // the old owner gets them back once they are free again
+        enqueue(owner, lost);
+    }
+
+    if (decision.joinable)
+        m_stats.increment(Statistics::SharedGrants);
+
+    return decision.granted;
+}
+
+/**
+ * Hysteresis against ownership ping-pong between clients of similar
+ * priority: an owner keeps what it got less than MinHoldTime ago, and a
+ * pair of clients preempts each other at most PairPreemptionLimit times
+ * per window. Clients further apart than DampingPriorityBand, and
+ * preemptions a [PreemptionRules] entry allows, are never held back.
+ * Returns when @client may take @resources from @owner, 0 if it may now.
+ */
+qint64 ResourceManager::dampedUntil(const ResourceClient* client, const ResourceClient* owner,
+    ResourcePolicy::ResourceMask resources) const
+{
+    const PolicySnapshot* settings = m_config->snapshot();
+    if (settings->minHoldTime <= 0 && settings->pairPreemptionLimit <= 0)
+        return 0;
+
+    if (std::abs(m_priority->rank(client) - m_priority->rank(owner)) > settings->dampingPriorityBand
+        || m_priority->isRuleOverride(client, owner, resources))
+        return 0;
+
+    const qint64 now = m_clock.elapsed();
+    qint64 until = 0;
+
+    if (settings->minHoldTime > 0) {
+        for (ResourcePolicy::ResourceMask bits = resources; bits; bits &= bits - 1) {
+            const qint64 expiry = m_heldSince[std::countr_zero(bits)] + settings->minHoldTime;
+            if (expiry > now)
+                until = std::max(until, expiry);
         }
     }
+
+    if (settings->pairPreemptionLimit > 0) {
+        const auto it = m_pairPreemptions.constFind(pairKey(client, owner));
+        if (it != m_pairPreemptions.constEnd() && now - it->windowStart < settings->pairPreemptionWindow
+            && it->count >= settings->pairPreemptionLimit)
+            until = std::max(until, it->windowStart + settings->pairPreemptionWindow);
+    }
+
+    return until;
 }
 
-void ResourceManager::releaseAll(ResourceClient* client)
+void ResourceManager::notePreemption(const ResourceClient* client, const ResourceClient* owner)
 {
-    if (!client)
+    const PolicySnapshot* settings = m_config->snapshot();
+    if (settings->pairPreemptionLimit <= 0)
         return;
 
-    const auto resources = client->resources();
+    const qint64 now = m_clock.elapsed();
+    PairHistory& pair = m_pairPreemptions[pairKey(client, owner)];
+    if (now - pair.windowStart >= settings->pairPreemptionWindow)
+        pair = { now, 0 };
+    ++pair.count;
+}
 
-    for (const QString& res : resources) {
-        m_resourceOwners.remove(res);
-        client->removeResource(res);
-    }
+void ResourceManager::scheduleRetry(const ResourceClient* client, qint64 retryAt)
+{
+    m_damped.insert(client->clientID(), retryAt);
+
+    const qint64 delay = std::max<qint64>(0, retryAt - m_clock.elapsed());
+    if (!m_retryTimer->isActive() || m_retryTimer->remainingTime() > delay)
+        m_retryTimer->start(int(delay));
 }
 
-bool ResourceManager::isOwner(const QString& resource,
-    const ResourceClient* client) const
+/**
+ * Decide again for the clients whose damping has ended. Those that would
+ * still get nothing keep waiting quietly, a repeated Denied helps nobody.
+ */
+void ResourceManager::retryDamped()
 {
-    return m_resourceOwners.value(resource) == client;
+    const qint64 now = m_clock.elapsed();
+    const QHash<uint, qint64> damped = std::exchange(m_damped, {});
+
+    for (auto it = damped.cbegin(); it != damped.cend(); ++it) {
+        ResourceClient* client = clientById(it.key());
+        const ResourcePolicy::ResourceMask waiting = client ? waitingResources(client) : 0;
+        if (!waiting)
+            continue;
+
+        if (it.value() > now) {
+            scheduleRetry(client, it.value());
+            continue;
+        }
+
+        const ResourcePolicy::ResourceMask required = waiting & client->mandatory();
+        const Decision decision = decide(client, required ? required : waiting);
+        if (required ? decision.denied : !decision.granted) {
+            if (decision.retryAt)
+                scheduleRetry(client, decision.retryAt);
+            continue;
+        }
+
+        requestResources(client, waiting);
+    }
 }
 
-void ResourceManager::emitGranted(ResourceClient* client)
+ResourceClient* ResourceManager::addClient(uint id, const QString& service, int priority)
 {
-    QDBusMessage sig = QDBusMessage::createSignal(
-        client->objectPath(),
-        "org.maemo.resource.client",
-        "granted");
+    ResourceClient* client = m_pool.allocate();
 
-    sig << 9
-        << client->clientType()
-        << (uint)client->clientID()
-        << (uint)client->clientReqqno()
-        << (uint)0
-        << "ok";
+    // all sets of one peer share the bucket's copy of its name
+    auto bucket = m_clientsByService.find(service);
+    if (bucket == m_clientsByService.end())
+        bucket = m_clientsByService.insert(service, {});
+    bucket->append(client);
 
-    QDBusConnection::systemBus().send(sig);
+    client->setClientID(id);
+    client->setServiceName(bucket.key());
+    client->setPriority(priority);
 
-    qCDebug(lcResourceDaemonCoreLog) << "Granted resource"
-                    << "rtype=" << client->clientType()
-                    << "id=" << client->clientID()
-                    << "reqno=" << client->clientReqqno()
-                    << "to" << client->objectPath();
+    m_clientsById.insert(id, client);
 
-    QDBusMessage status = QDBusMessage::createSignal(
-        client->objectPath(),
-        "org.maemo.resource.client",
-        "status");
+    return client;
+}
 
-    status << 9
-           << client->clientType() // rtype (int32)
-           << (uint)client->clientID() // id (uint32)
-           << (uint)client->clientReqqno() // reqno (uint32)
-           << (uint)1; // status = ACTIVE
+void ResourceManager::removeClient(ResourceClient* client)
+{
+    qCDebug(lcResourceDaemonCoreLog) << "Client destroyed" << client->objectPath();
+
+    releaseAll(client);
 
-    QDBusConnection::systemBus().send(status);
+    m_clientsById.remove(client->clientID());
+    m_store.remove(client->clientID());
+    m_damped.remove(client->clientID());
+
+    if (!m_pairPreemptions.isEmpty()) {
+        const uint id = client->clientID();
+        m_pairPreemptions.removeIf([id](const auto& it) {
+            return uint(it.key() >> 32) == id || uint(it.key()) == id;
+        });
+    }
+
+    m_pool.release(client);
 }
 
-/* private */
+/**
+ * Class ids index the rules of one snapshot, resolve them again after a reload.
+ */
+void ResourceManager::reclassifyClients()
+{
+    const PreemptionTable& rules = m_config->snapshot()->preemptionRules;
+    for (ResourceClient* client : std::as_const(m_clientsById))
+        client->setClassId(rules.classId(client->clientClass()));
+}
 
 void ResourceManager::grant(ResourceClient* client,
-    const QString& resource)
+    ResourcePolicy::ResourceMask resources)
 {
-    m_resourceOwners.insert(resource, client);
-    client->addResource(resource);
+    attach(client, resources);
+    m_store.setGranted(client->clientID(), client->resources());
 
-    client->notifyGranted(resource);
+    emit clientNotified(client, ResourceClient::Granted, resources);
+    m_stats.increment(Statistics::Grants);
+    m_recorder.record(FlightRecorder::Grant, client->clientID(), 0, resources);
 
-    qCDebug(lcResourceDaemonCoreLog) << "Granted" + resource + " to " + client->objectPath();
+    qCDebug(lcResourceDaemonCoreLog) << "Granted" << ResourcePolicy::resourceNames(resources) << "to" << client->objectPath();
 }
 
 void ResourceManager::preempt(ResourceClient* oldClient,
     ResourceClient* newClient,
-    const QString& resource)
+    ResourcePolicy::ResourceMask resources)
+{
+    qCDebug(lcResourceDaemonCoreLog) << "Preempting" << ResourcePolicy::resourceNames(resources) << "from" << oldClient->objectPath() << "to" << newClient->objectPath();
+
+    removeHolder(oldClient, resources);
+    emit clientNotified(oldClient, ResourceClient::Lost, resources);
+    m_recorder.record(FlightRecorder::Preempt, oldClient->clientID(), 0, resources, newClient->clientID());
+}
+
+/**
+ * Add @client to the owner sets of @resources.
+ */
+void ResourceManager::attach(ResourceClient* client,
+    ResourcePolicy::ResourceMask resources)
+{
+    // a resource nobody holds takes the new holder's share mode
+    const ResourcePolicy::ResourceMask fresh = resources & ~m_ownedMask;
+    m_sharedMask = (m_sharedMask & ~fresh) | (fresh & client->share());
+
+    const qint64 now = m_clock.elapsed();
+    for (ResourcePolicy::ResourceMask bits = fresh; bits; bits &= bits - 1)
+        m_heldSince[std::countr_zero(bits)] = now;
+
+    m_ownedMask |= resources;
+    client->addResources(resources);
+
+    for (ResourcePolicy::ResourceMask bits = resources; bits; bits &= bits - 1)
+        m_owners[std::countr_zero(bits)].clients.append(client);
+}
+
+/**
+ * Drop @client from the owner sets of @resources.
+ * Returns the resources that have no holder left.
+ */
+ResourcePolicy::ResourceMask ResourceManager::removeHolder(ResourceClient* client,
+    ResourcePolicy::ResourceMask resources)
+{
+    ResourcePolicy::ResourceMask freed = 0;
+
+    for (ResourcePolicy::ResourceMask bits = resources; bits; bits &= bits - 1) {
+        const int atom = std::countr_zero(bits);
+        OwnerSet& owners = m_owners[atom];
+        owners.clients.removeOne(client);
+        if (owners.clients.isEmpty())
+            freed |= ResourcePolicy::maskOf(atom);
+    }
+
+    m_ownedMask &= ~freed;
+    m_sharedMask &= ~freed;
+    client->removeResources(resources);
+    m_store.setGranted(client->clientID(), client->resources());
+
+    return freed;
+}
+
+void ResourceManager::enqueue(ResourceClient* client,
+    ResourcePolicy::ResourceMask resources)
 {
-    qCDebug(lcResourceDaemonCoreLog) <<  "Preempting" + resource + " from " + oldClient->objectPath() + " to " + newClient->objectPath();
+    if (!resources)
+        return;
+
+    auto it = m_waiting.find(client);
+    if (it == m_waiting.end()) {
+        // a client keeps its place in line across retries
+        it = m_waiting.insert(client, { { m_priority->rank(client), ++m_lastTicket, client }, 0 });
+    }
 
-    oldClient->removeResource(resource);
-    oldClient->notifyLost(resource);
+    const ResourcePolicy::ResourceMask added = resources & ~it->resources;
+    for (ResourcePolicy::ResourceMask bits = added; bits; bits &= bits - 1)
+        m_waiters[std::countr_zero(bits)].insert(it->waiter);
+
+    it->resources |= added;
+}
+
+void ResourceManager::dequeue(const ResourceClient* client,
+    ResourcePolicy::ResourceMask resources)
+{
+    auto it = m_waiting.find(client);
+    if (it == m_waiting.end())
+        return;
 
-    m_resourceOwners.remove(resource);
+    const ResourcePolicy::ResourceMask removed = resources & it->resources;
+    for (ResourcePolicy::ResourceMask bits = removed; bits; bits &= bits - 1)
+        m_waiters[std::countr_zero(bits)].erase(it->waiter);
 
-    grant(newClient, resource);
+    it->resources &= ~removed;
+    if (!it->resources)
+        m_waiting.erase(it);
+}
+
+/**
+ * Give every freed resource to the best client waiting for it. A waiter
+ * that needs it for its mandatory set only gets it together with the rest
+ * of that set, otherwise the next one in line is tried. A resource handed
+ * over in shared mode also goes to every later waiter that can join.
+ */
+void ResourceManager::handOff(ResourcePolicy::ResourceMask resources)
+{
+    for (ResourcePolicy::ResourceMask bits = resources; bits; bits &= bits - 1) {
+        const int atom = std::countr_zero(bits);
+        const ResourcePolicy::ResourceMask freed = ResourcePolicy::maskOf(atom);
+
+        if (m_ownedMask & freed)
+            continue;
+
+        std::set<Waiter>& waiters = m_waiters[atom];
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            ResourceClient* next = it->client;
+            ++it; // dequeue() erases this entry
+            const ResourcePolicy::ResourceMask waiting = m_waiting.value(next).resources;
+            const ResourcePolicy::ResourceMask wanted = (freed & next->mandatory()) ? waiting & next->mandatory() : freed;
+
+            // an optional bit is only worth something next to the whole mandatory set
+            if (!(freed & next->mandatory()) && (next->resources() & next->mandatory()) != next->mandatory())
+                continue;
+
+            // everything else it needs must be free or joinable as well
+            const ResourcePolicy::ResourceMask blocked = wanted & m_ownedMask & ~(m_sharedMask & next->share());
+            if (blocked)
+                continue;
+
+            dequeue(next, wanted);
+            m_recorder.record(FlightRecorder::Handoff, next->clientID(), 0, wanted);
+            grant(next, wanted);
+            m_stats.increment(Statistics::Handoffs);
+
+            qCDebug(lcResourceDaemonCoreLog) << "Handed" << ResourcePolicy::resourceNames(wanted)
+                                             << "over to waiting" << next->objectPath();
+
+            // taken in shared mode: the waiters that share it join right away
+            if (!(m_sharedMask & freed))
+                break;
+        }
+    }
 }
@@ -20,16 +20,31 @@
 #ifndef RESOURCEMANAGER_H
 #define RESOURCEMANAGER_H
 
+#include "clientpool.h"
+#include "resourceclient.h"
+#include "resourcetypes.h"
+#include "util/flightrecorder.h"
+#include "util/ownershipstore.h"
+#include "util/statistics.h"
+
 #include <QDBusContext>
 #include <QDBusMessage>
 #include <QDBusObjectPath>
-#include <QMap>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QStringList>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <array>
+#include <set>
 
-class ResourceClient;
+class Config;
 class SecurityPolicy;
 class PriorityPolicy;
+class QTimer;
 
 /**
  * Core resource manager.
@@ -44,37 +59,165 @@ public:
     // client lifecycle
     ResourceClient* createClient(const QDBusMessage& message,
         int priority);
+    ResourceClient* createClient(const QString& service,
+        int priority);
     void destroyClient(ResourceClient* client);
-
-    QList<ResourceClient*> clients() const { return m_clients; }
-
-    // resource management
-    void requestResources(ResourceClient* client,
-        const QStringList& resources);
+    void persistClient(const ResourceClient* client);
+    QList<ResourceClient*> restoreClients(const QSet<QString>& liveServices);
+    int destroyClientsForService(const QString& service);
+    void setClientClass(ResourceClient* client, const QString& klass, const QString& mode);
+
+    // client registry, O(1) lookups
+    ResourceClient* clientById(uint id) const { return m_clientsById.value(id, nullptr); }
+    ResourceClient* clientByPath(const QString& path) const;
+    QList<ResourceClient*> clientsForService(const QString& service) const { return m_clientsByService.value(service); }
+    qsizetype clientCount() const { return m_clientsById.size(); }
+    const ClientPool& pool() const { return m_pool; }
+
+    // resource management, returns the resources the client holds afterwards
+    ResourcePolicy::ResourceMask requestResources(ResourceClient* client,
+        ResourcePolicy::ResourceMask resources);
     void releaseAll(ResourceClient* client);
 
     // queries
-    bool isOwner(const QString& resource,
+    bool isOwner(ResourcePolicy::ResourceMask resources,
         const ResourceClient* client) const;
-
-    void emitGranted(ResourceClient* client);
+    ResourceClient* owner(ResourcePolicy::ResourceAtom resource) const
+    {
+        return resource < ResourcePolicy::MaxResources && m_owners[resource].refs() ? m_owners[resource].clients.first() : nullptr;
+    }
+    int ownerCount(ResourcePolicy::ResourceAtom resource) const { return resource < ResourcePolicy::MaxResources ? m_owners[resource].refs() : 0; }
+    ResourcePolicy::ResourceMask ownedResources() const { return m_ownedMask; }
+    ResourcePolicy::ResourceMask sharedResources() const { return m_sharedMask; }
+    ResourcePolicy::ResourceMask waitingResources(const ResourceClient* client) const { return m_waiting.value(client).resources; }
+    qsizetype waitingClients() const { return m_waiting.size(); }
+
+    Config* config() const { return m_config; }
+    const SecurityPolicy* security() const { return m_security; }
+    FlightRecorder& recorder() { return m_recorder; }
+    OwnershipStore& store() { return m_store; }
+
+    Statistics& stats() { return m_stats; }
+    const Statistics& stats() const { return m_stats; }
 
     QDBusMessage getMessage() { return message(); }
 
+signals:
+    // ownership of @client changed, or its request was denied
+    void clientNotified(ResourceClient* client, ResourceClient::Event event, ResourcePolicy::ResourceMask resources);
+
 private:
+    // outcome of one arbitration round, see decide()
+    struct Decision {
+        ResourcePolicy::ResourceMask granted = 0;
+        ResourcePolicy::ResourceMask joinable = 0;
+        ResourcePolicy::ResourceMask taken = 0;
+        ResourcePolicy::ResourceMask denied = 0;
+        QVarLengthArray<ResourceClient*, 4> yielding;
+        int suppressed = 0; // owners kept by dampedUntil()
+        qint64 retryAt = 0; // when the last of them may be preempted, ms on m_clock
+    };
+
+    Decision decide(ResourceClient* client,
+        ResourcePolicy::ResourceMask resources) const;
+    ResourcePolicy::ResourceMask commit(ResourceClient* client,
+        const Decision& decision);
+
+    // preemption hysteresis
+    qint64 dampedUntil(const ResourceClient* client, const ResourceClient* owner,
+        ResourcePolicy::ResourceMask resources) const;
+    void notePreemption(const ResourceClient* client, const ResourceClient* owner);
+    void scheduleRetry(const ResourceClient* client, qint64 retryAt);
+    void retryDamped();
+
+    ResourceClient* addClient(uint id, const QString& service, int priority);
+    void removeClient(ResourceClient* client);
+    void reclassifyClients();
     void grant(ResourceClient* client,
-        const QString& resource);
+        ResourcePolicy::ResourceMask resources);
+    void attach(ResourceClient* client,
+        ResourcePolicy::ResourceMask resources);
     void preempt(ResourceClient* oldClient,
         ResourceClient* newClient,
-        const QString& resource);
+        ResourcePolicy::ResourceMask resources);
+    ResourcePolicy::ResourceMask removeHolder(ResourceClient* client,
+        ResourcePolicy::ResourceMask resources);
 
-private:
-    // resource → owner
-    QMap<QString, ResourceClient*> m_resourceOwners;
-
-    // active clients
-    QList<ResourceClient*> m_clients;
+    // wait queues
+    void enqueue(ResourceClient* client,
+        ResourcePolicy::ResourceMask resources);
+    void dequeue(const ResourceClient* client,
+        ResourcePolicy::ResourceMask resources);
+    void handOff(ResourcePolicy::ResourceMask resources);
 
+private:
+    // holders of one resource, more than one only while it is shared
+    struct OwnerSet {
+        QVarLengthArray<ResourceClient*, 2> clients;
+
+        int refs() const { return int(clients.size()); }
+    };
+
+    // preemptions between one pair of clients in the current window
+    struct PairHistory {
+        qint64 windowStart = 0;
+        int count = 0;
+    };
+
+    static quint64 pairKey(const ResourceClient* a, const ResourceClient* b)
+    {
+        const auto [low, high] = std::minmax(a->clientID(), b->clientID());
+        return quint64(low) << 32 | high;
+    }
+
+    // wait queue entry: best rank first, FIFO within a rank
+    struct Waiter {
+        int rank;
+        quint64 ticket;
+        ResourceClient* client;
+
+        bool operator<(const Waiter& other) const
+        {
+            return rank != other.rank ? rank > other.rank : ticket < other.ticket;
+        }
+    };
+
+    struct WaitEntry {
+        Waiter waiter {};
+        ResourcePolicy::ResourceMask resources = 0;
+    };
+
+    // resource atom → owners, m_ownedMask has a bit set for every non-empty set
+    // and m_sharedMask for those held in shared mode
+    std::array<OwnerSet, ResourcePolicy::MaxResources> m_owners;
+    ResourcePolicy::ResourceMask m_ownedMask;
+    ResourcePolicy::ResourceMask m_sharedMask;
+
+    // resource atom → when it was taken by its current holders, ms on m_clock
+    std::array<qint64, ResourcePolicy::MaxResources> m_heldSince;
+    QHash<quint64, PairHistory> m_pairPreemptions;
+    QElapsedTimer m_clock;
+
+    // client id → when the damping that keeps it waiting ends, ms on m_clock
+    QHash<uint, qint64> m_damped;
+    QTimer* m_retryTimer;
+
+    // resource atom → clients waiting for it, and what each client waits for
+    std::array<std::set<Waiter>, ResourcePolicy::MaxResources> m_waiters;
+    QHash<const ResourceClient*, WaitEntry> m_waiting;
+    quint64 m_lastTicket;
+
+    // active clients, indexed by id / owning bus name; the records live in m_pool
+    ClientPool m_pool;
+    QHash<uint, ResourceClient*> m_clientsById;
+    QHash<QString, QList<ResourceClient*>> m_clientsByService;
+    uint m_lastClientId;
+
+    Statistics m_stats;
+    FlightRecorder m_recorder;
+    OwnershipStore m_store;
+
+    Config* m_config;
     SecurityPolicy* m_security;
     PriorityPolicy* m_priority;
 };
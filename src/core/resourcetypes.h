@@ -2,6 +2,13 @@
 #define RESOURCETYPES_H
 
 #include <QString>
+#include <QStringList>
+#include <QStringView>
+
+#include <array>
+#include <bit>
+#include <string_view>
+#include <utility>
 
 namespace ResourcePolicy {
 
@@ -42,6 +49,130 @@ namespace Resource {
     inline constexpr const char* Display = "Display";
 
 } // namespace Resource
+
+/**
+ * Resource set as carried by libresource messages:
+ * one bit per resource, see RESMSG_* in res-msg.h.
+ */
+using ResourceMask = quint32;
+
+inline constexpr int MaxResources = 32;
+
+namespace Bit {
+
+    inline constexpr ResourceMask AudioPlayback = 1u << 0;
+    inline constexpr ResourceMask VideoPlayback = 1u << 1;
+    inline constexpr ResourceMask AudioRecording = 1u << 2;
+    inline constexpr ResourceMask VideoRecording = 1u << 3;
+    inline constexpr ResourceMask Vibra = 1u << 4;
+    inline constexpr ResourceMask Leds = 1u << 5;
+    inline constexpr ResourceMask Backlight = 1u << 6;
+    inline constexpr ResourceMask SystemButton = 1u << 8;
+    inline constexpr ResourceMask LockButton = 1u << 9;
+    inline constexpr ResourceMask ScaleButton = 1u << 10;
+    inline constexpr ResourceMask SnapButton = 1u << 11;
+    inline constexpr ResourceMask LensCover = 1u << 12;
+    inline constexpr ResourceMask HeadsetButtons = 1u << 13;
+    inline constexpr ResourceMask LargeScreen = 1u << 14;
+
+} // namespace Bit
+
+/**
+ * Interned resource name: the index of the resource's bit in a ResourceMask.
+ * Names are mapped to atoms once where they enter the daemon, the core only
+ * ever sees atoms and masks.
+ */
+using ResourceAtom = quint8;
+
+inline constexpr ResourceAtom InvalidAtom = 0xff;
+
+/** Canonical name of every atom, libresource bits first. */
+inline constexpr std::array<std::string_view, MaxResources> AtomNames = {
+    "AudioPlayback", "VideoPlayback", "AudioRecording", "VideoRecording",
+    "Vibra", "Leds", "Backlight", {},
+    "SystemButton", "LockButton", "ScaleButton", "SnapButton",
+    "LensCover", "HeadsetButtons", "LargeScreen", {},
+    // resources libresource has no bit for
+    Resource::HardwareKeys, Resource::Alarm, Resource::VoiceCall, Resource::TouchInput,
+    Resource::Location, Resource::Network
+};
+
+/** Well-known names that share an atom with a libresource resource. */
+inline constexpr std::array<std::pair<std::string_view, ResourceAtom>, 3> AtomAliases = { {
+    { Resource::AudioCapture, 2 },
+    { Resource::VideoOutput, 1 },
+    { Resource::Display, 6 },
+} };
+
+constexpr ResourceAtom atomOf(std::string_view name)
+{
+    if (name.empty())
+        return InvalidAtom;
+
+    for (std::size_t i = 0; i < AtomNames.size(); ++i) {
+        if (AtomNames[i] == name)
+            return ResourceAtom(i);
+    }
+    for (const auto& alias : AtomAliases) {
+        if (alias.first == name)
+            return alias.second;
+    }
+    return InvalidAtom;
+}
+
+constexpr ResourceMask maskOf(ResourceAtom atom)
+{
+    return atom < MaxResources ? ResourceMask(1u) << atom : 0;
+}
+
+/** Runtime counterpart of atomOf(), used at the bus/config boundary. */
+inline ResourceAtom intern(QStringView name)
+{
+    for (std::size_t i = 0; i < AtomNames.size(); ++i) {
+        if (!AtomNames[i].empty() && name == QLatin1String(AtomNames[i].data(), AtomNames[i].size()))
+            return ResourceAtom(i);
+    }
+    for (const auto& alias : AtomAliases) {
+        if (name == QLatin1String(alias.first.data(), alias.first.size()))
+            return alias.second;
+    }
+    return InvalidAtom;
+}
+
+/** Resource names for debug output. */
+inline QStringList resourceNames(ResourceMask resources)
+{
+    QStringList names;
+    for (ResourceMask bits = resources; bits; bits &= bits - 1) {
+        const std::string_view name = AtomNames[std::countr_zero(bits)];
+        names << (name.empty() ? QString::number(std::countr_zero(bits))
+                               : QString::fromLatin1(name.data(), name.size()));
+    }
+    return names;
+}
+
+/** Atoms of the well-known names, resolved at compile time. */
+namespace Atom {
+
+    inline constexpr ResourceAtom HardwareKeys = atomOf(Resource::HardwareKeys);
+    inline constexpr ResourceAtom AudioPlayback = atomOf(Resource::AudioPlayback);
+    inline constexpr ResourceAtom AudioCapture = atomOf(Resource::AudioCapture);
+    inline constexpr ResourceAtom Alarm = atomOf(Resource::Alarm);
+    inline constexpr ResourceAtom VoiceCall = atomOf(Resource::VoiceCall);
+    inline constexpr ResourceAtom VideoOutput = atomOf(Resource::VideoOutput);
+    inline constexpr ResourceAtom TouchInput = atomOf(Resource::TouchInput);
+    inline constexpr ResourceAtom Location = atomOf(Resource::Location);
+    inline constexpr ResourceAtom Network = atomOf(Resource::Network);
+    inline constexpr ResourceAtom Display = atomOf(Resource::Display);
+
+} // namespace Atom
+
+static_assert(maskOf(Atom::AudioPlayback) == Bit::AudioPlayback);
+static_assert(maskOf(Atom::AudioCapture) == Bit::AudioRecording);
+static_assert(maskOf(Atom::VideoOutput) == Bit::VideoPlayback);
+static_assert(maskOf(Atom::Display) == Bit::Backlight);
+static_assert(Atom::Network != InvalidAtom);
+
 } // namespace ResourcePolicy
 
 #endif // RESOURCETYPES_H
@@ -20,11 +20,12 @@
 #include "clientadaptor.h"
 #include "core/resourceclient.h"
 #include "util/logger.h"
+#include "util/traffictrace.h"
 
 #include <QDBusMessage>
 #include <qdbusconnection.h>
 
-ClientAdaptor::ClientAdaptor(ResourceClient* parent)
+ClientAdaptor::ClientAdaptor(QObject* parent)
     : QDBusVirtualObject(parent)
 {
 }
@@ -53,49 +54,63 @@ QString ClientAdaptor::introspect(const QString& path) const
     )";
 }
 
+const ClientAdaptor::Route ClientAdaptor::s_routes[] = {
+    { QLatin1String("org.maemo.resource.client"), QLatin1String("grant"), QLatin1String("iuuu") },
+    { QLatin1String("org.maemo.resource.client"), QLatin1String("advice"), QLatin1String("iuuu") },
+};
+
 bool ClientAdaptor::handleMessage(const QDBusMessage& message, const QDBusConnection& connection)
 {
     if (message.type() != QDBusMessage::MethodCallMessage)
         return false;
 
-    if (message.interface() == QLatin1String("org.freedesktop.DBus.Introspectable"))
-        return false;
+    const QString interface = message.interface();
+    const QString member = message.member();
 
-    if (message.interface() != "org.maemo.resource.client")
-        return false;
+    for (const Route& route : s_routes) {
+        if (member != route.member || interface != route.interface)
+            continue;
 
-    uint clientId = message.arguments()[1].toUInt();
-    uint reqno = message.arguments()[2].toUInt();
+        if (message.signature() != route.signature)
+            return false;
 
-    printDebug(message);
+        // arguments are demarshalled once
+        const QVariantList args = message.arguments();
+        const uint clientId = args[1].toUInt();
+        const uint reqno = args[2].toUInt();
 
-    // ---- Method reply ----
-    QVariantList replyArgs;
-    replyArgs << 5
-              << (uint)clientId
-              << (uint)reqno
-              << (uint)1024;
+        if (lcResourceDaemonCoreLog().isDebugEnabled())
+            printDebug(args);
 
-    QDBusMessage reply = message.createReply(replyArgs);
-    connection.send(reply);
+        if (TrafficTrace* trace = TrafficTrace::instance())
+            trace->recordCall(TrafficTrace::ClientCall, message.service(), args, member);
 
-    qCDebug(lcResourceDaemonCoreLog) << "==== send messsage ==========";
-    qCDebug(lcResourceDaemonCoreLog) << "Type   : " << replyArgs[0].toInt();
-    qCDebug(lcResourceDaemonCoreLog) << "ID     : " << replyArgs[1].toUInt();
-    qCDebug(lcResourceDaemonCoreLog) << "Req NO : " << replyArgs[2].toUInt();
+        // ---- Method reply ----
+        QVariantList replyArgs;
+        replyArgs << 5
+                  << (uint)clientId
+                  << (uint)reqno
+                  << (uint)1024;
 
-    return true;
-}
+        QDBusMessage reply = message.createReply(replyArgs);
+        connection.send(reply);
 
-void ClientAdaptor::printDebug(const QDBusMessage& message)
-{
-    if (message.arguments().count() < 3) {
-        qCDebug(lcResourceDaemonCoreLog) << "==== skip system message ===";
-        return;
+        qCDebug(lcResourceDaemonCoreLog) << "==== send messsage ==========";
+        qCDebug(lcResourceDaemonCoreLog) << "Type   : " << replyArgs[0].toInt();
+        qCDebug(lcResourceDaemonCoreLog) << "ID     : " << replyArgs[1].toUInt();
+        qCDebug(lcResourceDaemonCoreLog) << "Req NO : " << replyArgs[2].toUInt();
+
+        return true;
     }
 
+    // Introspectable and unknown calls are answered by QtDBus
+    return false;
+}
+
+void ClientAdaptor::printDebug(const QVariantList& args)
+{
     qCDebug(lcResourceDaemonCoreLog) << "==== got messsage ==========";
-    qCDebug(lcResourceDaemonCoreLog) <<  "Type   : " << message.arguments()[0].toInt();
-    qCDebug(lcResourceDaemonCoreLog) <<  "ID     : " << message.arguments()[1].toUInt();
-    qCDebug(lcResourceDaemonCoreLog) <<  "Req NO : " << message.arguments()[2].toUInt();
+    qCDebug(lcResourceDaemonCoreLog) <<  "Type   : " << args[0].toInt();
+    qCDebug(lcResourceDaemonCoreLog) <<  "ID     : " << args[1].toUInt();
+    qCDebug(lcResourceDaemonCoreLog) <<  "Req NO : " << args[2].toUInt();
 }
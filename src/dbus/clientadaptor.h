@@ -27,16 +27,28 @@
 #include <QStringList>
 #include <qdbusvirtualobject.h>
 
+/**
+ * Answers the calls libresource makes on its own resource set objects.
+ * Replies do not depend on the set, so one instance is exported at the
+ * path of every client of a connection.
+ */
 class ClientAdaptor : public QDBusVirtualObject {
     Q_OBJECT
 public:
-    explicit ClientAdaptor(ResourceClient* parent);
+    explicit ClientAdaptor(QObject* parent = nullptr);
     ~ClientAdaptor() override;
     QString introspect(const QString& path) const override;
     bool handleMessage(const QDBusMessage& message, const QDBusConnection& connection) override;
 
 private:
-    void printDebug(const QDBusMessage& message);
+    struct Route {
+        QLatin1String interface;
+        QLatin1String member;
+        QLatin1String signature;
+    };
+    static const Route s_routes[];
+
+    void printDebug(const QVariantList& args);
 };
 
 #endif // CLIENTADAPTOR_H
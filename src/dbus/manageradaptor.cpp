@@ -21,27 +21,70 @@
 #include "core/resourceclient.h"
 #include "core/resourcemanager.h"
 #include "dbus/clientadaptor.h"
+#include "dbus/notificationbatcher.h"
+#include "dbus/peerserver.h"
+#include "policy/securitypolicy.h"
+#include "util/asynclogger.h"
+#include "util/config.h"
 #include "util/logger.h"
+#include "util/statistics.h"
+#include "util/traffictrace.h"
 
 #include <QDBusConnection>
 #include <QDBusContext>
+#include <QDBusError>
 #include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QThread>
 #include <qdbusconnectioninterface.h>
 #include <qfileinfo.h>
 
-ManagerAdaptor::ManagerAdaptor(ResourceManager* parent)
+#include <atomic>
+#include <bit>
+
+// tags the clients of each adaptor, the manager reports all of them
+static std::atomic<quint32> s_lastChannel { 0 };
+
+ManagerAdaptor::ManagerAdaptor(ResourceManager* manager, QObject* parent)
     : QDBusVirtualObject(parent)
-    , m_clientsCount(0)
+    , m_manager(manager)
+    , m_toArbitration(new Mailbox)
+    , m_toIo(new Mailbox(this))
+    , m_batcher(new NotificationBatcher(manager))
+    , m_clientConnection(QString())
+    , m_watcher(nullptr)
+    , m_clientAdaptor(new ClientAdaptor(this))
+    , m_channel(++s_lastChannel)
+    , m_closing(false)
+    , m_peerServer(nullptr)
+    , m_authenticated(false)
 {
+    // the arbitration side lives with the manager, wherever it is created
+    m_toArbitration->moveToThread(manager->thread());
+    m_batcher->moveToThread(manager->thread());
+
+    // grants are encoded and sent by the I/O thread like replies
+    m_batcher->setSender([this](const QDBusConnection& connection, const QDBusMessage& message) {
+        send(connection, message);
+    });
+
+    // ownership changes are reported with one grant() per dispatch
+    m_notifier = connect(manager, &ResourceManager::clientNotified, m_batcher,
+        [this](ResourceClient* client, ResourceClient::Event event, ResourcePolicy::ResourceMask) {
+            if (event != ResourceClient::Denied && client->channel() == m_channel)
+                m_batcher->queueGrant(client, 0, m_clientConnection);
+        });
 }
 
 ManagerAdaptor::~ManagerAdaptor()
 {
-}
-
-ResourceManager* ManagerAdaptor::parent() const
-{
-    return static_cast<ResourceManager*>(QObject::parent());
+    disconnect(m_notifier);
+    // both threads are stopped by now, or peerDisconnected() retired these
+    delete m_batcher;
+    delete m_toArbitration;
 }
 
 QString ManagerAdaptor::introspect(const QString& path) const
@@ -97,48 +140,304 @@ QString ManagerAdaptor::introspect(const QString& path) const
         <arg type="i" direction="out"/>  <!-- error -->
         <arg type="s" direction="out"/>  <!-- message -->
     </method>
+</interface>
+<interface name="org.maemo.resource.manager.Stats">
+    <method name="GetCounters">
+        <arg type="a{sv}" direction="out"/>  <!-- name -> uint64 -->
+    </method>
+    <method name="GetLatency">
+        <arg type="s" direction="in"/>   <!-- register, acquire, release, unregister -->
+        <arg type="t" direction="out"/>  <!-- count -->
+        <arg type="t" direction="out"/>  <!-- total ns -->
+        <arg type="at" direction="out"/> <!-- bucket i: below 2^i ns -->
+    </method>
+</interface>
+<interface name="org.maemo.resource.manager.PeerToPeer">
+    <method name="GetPeerAddress">
+        <arg type="s" direction="in"/>   <!-- well-known name of the caller -->
+        <arg type="s" direction="out"/>  <!-- address for QDBusConnection::connectToPeer() -->
+        <arg type="s" direction="out"/>  <!-- one-time token for Authenticate -->
+    </method>
+    <method name="Authenticate">     <!-- first call on the peer connection -->
+        <arg type="s" direction="in"/>   <!-- token from GetPeerAddress -->
+        <arg type="b" direction="out"/>
+    </method>
+</interface>
+<interface name="org.maemo.resource.manager.Config">
+    <method name="Reload">
+        <arg type="b" direction="out"/>  <!-- false: parse failed, previous config kept -->
+    </method>
 </interface>)";
 }
 
-bool ManagerAdaptor::handleMessage(const QDBusMessage& message, const QDBusConnection& connection)
+const ManagerAdaptor::Route ManagerAdaptor::s_routes[] = {
+    { QLatin1String("org.maemo.resource.manager"), QLatin1String("acquire"), QLatin1String("iuu"),
+        &ManagerAdaptor::acquireClient, Statistics::Acquire },
+    { QLatin1String("org.maemo.resource.manager"), QLatin1String("release"), QLatin1String("iuu"),
+        &ManagerAdaptor::releaseClient, Statistics::Release },
+    { QLatin1String("org.maemo.resource.manager"), QLatin1String("register"), QLatin1String("iuuuuuussu"),
+        &ManagerAdaptor::registerClient, Statistics::Register },
+    { QLatin1String("org.maemo.resource.manager"), QLatin1String("unregister"), QLatin1String("iuu"),
+        &ManagerAdaptor::unregisterClient, Statistics::Unregister },
+    { QLatin1String("org.maemo.resource.manager.Stats"), QLatin1String("GetCounters"), QLatin1String(""),
+        &ManagerAdaptor::getCounters, Statistics::MethodCount },
+    { QLatin1String("org.maemo.resource.manager.Stats"), QLatin1String("GetLatency"), QLatin1String("s"),
+        &ManagerAdaptor::getLatency, Statistics::MethodCount },
+    { QLatin1String("org.maemo.resource.manager.PeerToPeer"), QLatin1String("GetPeerAddress"), QLatin1String("s"),
+        &ManagerAdaptor::getPeerAddress, Statistics::MethodCount },
+    { QLatin1String("org.maemo.resource.manager.Config"), QLatin1String("Reload"), QLatin1String(""),
+        &ManagerAdaptor::reloadConfig, Statistics::MethodCount },
+};
+
+static TrafficTrace::Kind traceKind(Statistics::Method method)
 {
-    QString member = message.member();
-    QString interface = message.interface();
-
-    if (message.interface() == "org.freedesktop.DBus.Introspectable") {
-        return false;
+    switch (method) {
+    case Statistics::Register:
+        return TrafficTrace::Register;
+    case Statistics::Acquire:
+        return TrafficTrace::Acquire;
+    case Statistics::Release:
+        return TrafficTrace::Release;
+    case Statistics::Unregister:
+        return TrafficTrace::Unregister;
+    default:
+        return TrafficTrace::KindCount;
     }
+}
 
-    if (message.type() != QDBusMessage::MethodCallMessage)
-        return false;
+/**
+ * Signature of the call. Messages built locally (benchmarks) carry none,
+ * derive it from the arguments then.
+ */
+static QString messageSignature(const QDBusMessage& message, const QVariantList& args)
+{
+    QString signature = message.signature();
+    if (signature.isEmpty()) {
+        for (const QVariant& arg : args)
+            signature += QLatin1String(QDBusMetaType::typeToSignature(arg.metaType()));
+    }
+    return signature;
+}
 
-    if (message.interface() != "org.maemo.resource.manager")
+bool ManagerAdaptor::handleMessage(const QDBusMessage& message, const QDBusConnection& connection)
+{
+    if (message.type() != QDBusMessage::MethodCallMessage || m_closing)
         return false;
 
-    printDebug(message);
+    const QString interface = message.interface();
+    const QString member = message.member();
 
-    if (message.member() == "register") {
-        registerClient(message, connection);
-        return true;
-    }
-    if (message.member() == "unregister") {
+    // a peer connection is served once it presented its token
+    if (!m_peerName.isEmpty() && !m_authenticated) {
+        if (member == QLatin1String("Authenticate") && interface == QLatin1String("org.maemo.resource.manager.PeerToPeer"))
+            authenticate(message, connection);
+        else
+            connection.send(message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Authenticate first")));
         return true;
     }
 
-    if (message.member() == "acquire") {
-        acquireClient(message, connection);
+    for (const Route& route : s_routes) {
+        if (member != route.member || interface != route.interface)
+            continue;
+
+        // arguments are demarshalled once and handed to the handler
+        const QVariantList args = message.arguments();
+        if (!messageSignature(message, args).startsWith(route.signature))
+            return false;
+
+        if (lcResourceDaemonCoreLog().isDebugEnabled())
+            printDebug(args);
+
+        const Handler handler = route.handler;
+        const Statistics::Method method = route.method;
+        const bool queued = tryRunArbitration([this, handler, method, message, args, connection]() {
+            // record mode: in the order the calls are decided
+            if (TrafficTrace* trace = TrafficTrace::instance(); trace && method != Statistics::MethodCount)
+                trace->recordCall(traceKind(method), serviceOf(message), args);
+
+            if (method != Statistics::MethodCount) {
+                Statistics::Timer timer(manager()->stats(), method);
+                (this->*handler)(message, args, connection);
+            } else {
+                (this->*handler)(message, args, connection);
+            }
+        });
+
+        // arbitration is a full mailbox behind: push back on the caller
+        // instead of waiting, libresource retries later
+        if (!queued)
+            connection.send(message.createErrorReply(QDBusError::LimitsExceeded, QStringLiteral("Resource manager is busy")));
         return true;
     }
+
+    // Introspectable and unknown calls are answered by QtDBus
     return false;
 }
 
+void ManagerAdaptor::getCounters(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    Q_UNUSED(args);
+
+    const Statistics& stats = manager()->stats();
+
+    QVariantMap counters;
+    counters.insert(QStringLiteral("active_clients"), qulonglong(manager()->clientCount()));
+    counters.insert(QStringLiteral("owned_resources"), qulonglong(std::popcount(manager()->ownedResources())));
+    counters.insert(QStringLiteral("shared_resources"), qulonglong(std::popcount(manager()->sharedResources())));
+    counters.insert(QStringLiteral("waiting_clients"), qulonglong(manager()->waitingClients()));
+    for (int i = 0; i < Statistics::CounterCount; ++i) {
+        const auto counter = Statistics::Counter(i);
+        counters.insert(QLatin1String(Statistics::counterName(counter)), qulonglong(stats.counter(counter)));
+    }
+    counters.insert(QStringLiteral("notifications_queued"), qulonglong(m_batcher->queuedNotifications()));
+    counters.insert(QStringLiteral("messages_sent"), qulonglong(m_batcher->sentMessages()));
+    counters.insert(QStringLiteral("messages_saved"), qulonglong(m_batcher->savedMessages()));
+    counters.insert(QStringLiteral("calls_rejected"), qulonglong(m_toArbitration->rejected()));
+    counters.insert(QStringLiteral("replies_overflowed"), qulonglong(m_toIo->overflowed()));
+    const AsyncLogger* logger = AsyncLogger::instance();
+    counters.insert(QStringLiteral("log_written"), qulonglong(logger ? logger->written() : 0));
+    counters.insert(QStringLiteral("log_dropped"), qulonglong(logger ? logger->dropped() : 0));
+    counters.insert(QStringLiteral("config_generation"), qulonglong(manager()->config()->snapshot()->generation));
+
+    send(connection, message.createReply(QVariant(counters)));
+}
+
+void ManagerAdaptor::getLatency(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    const Statistics& stats = manager()->stats();
+    const QString name = args.value(0).toString();
+
+    for (int i = 0; i < Statistics::MethodCount; ++i) {
+        const auto method = Statistics::Method(i);
+        if (name != QLatin1String(Statistics::methodName(method)))
+            continue;
+
+        const LatencyHistogram& histogram = stats.latency(method);
+        QList<qulonglong> buckets(histogram.buckets().begin(), histogram.buckets().end());
+
+        send(connection, message.createReply(QVariantList {
+            qulonglong(histogram.count()),
+            qulonglong(histogram.total()),
+            QVariant::fromValue(buckets) }));
+        return;
+    }
+
+    send(connection, message.createErrorReply(QDBusError::InvalidArgs,
+        QStringLiteral("Unknown method %1").arg(name)));
+}
+
+/**
+ * Hand the peer-to-peer address to a trusted client that already has a
+ * resource set on the bus. @name must be allowed by the security policy
+ * and owned by the caller, which is checked with the bus asynchronously.
+ * The reply carries a one-time token the client presents on its new
+ * connection, the peer socket itself does not check uids.
+ */
+void ManagerAdaptor::getPeerAddress(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    const QString name = args.value(0).toString();
+
+    if (m_peerAddress.isEmpty() || !m_peerServer) {
+        send(connection, message.createErrorReply(QDBusError::NotSupported, QStringLiteral("Peer-to-peer is disabled")));
+        return;
+    }
+
+    if (manager()->clientsForService(message.service()).isEmpty() || !manager()->security()->isAllowedSender(name)) {
+        send(connection, message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Not a trusted client")));
+        return;
+    }
+
+    runIo([this, message, connection, name]() {
+        QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(
+            connection.interface()->asyncCall(QStringLiteral("GetNameOwner"), name), this);
+
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, message, connection](QDBusPendingCallWatcher* watcher) {
+            const QDBusPendingReply<QString> owner = *watcher;
+            watcher->deleteLater();
+
+            if (owner.isError() || owner.value() != message.service())
+                connection.send(message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Not a trusted client")));
+            else
+                connection.send(message.createReply(QVariantList { m_peerAddress, m_peerServer->issueToken() }));
+        });
+    });
+}
+
+/**
+ * Runs in the I/O thread, before anything else of the peer is served.
+ * Tokens are single use, a refused peer is dropped.
+ */
+void ManagerAdaptor::authenticate(const QDBusMessage& message, const QDBusConnection& connection)
+{
+    const QString token = message.arguments().value(0).toString();
+
+    if (m_peerServer && m_peerServer->redeemToken(token)) {
+        m_authenticated = true;
+        connection.send(message.createReply(QVariant(true)));
+        return;
+    }
+
+    qCWarning(lcResourceDaemonCoreLog) << "Peer" << m_peerName << "presented no valid token";
+    connection.send(message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Invalid token")));
+    peerDisconnected();
+}
+
+/**
+ * Re-read the config file. Clients and ownership are kept, new decisions
+ * use the new snapshot.
+ * Only root may reload; the bus policy says the same, the uid is checked
+ * here again in case the policy file is missing or too permissive.
+ */
+void ManagerAdaptor::reloadConfig(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    Q_UNUSED(args);
+
+    // peer-to-peer callers have no uid the bus vouches for
+    if (!m_peerName.isEmpty()) {
+        send(connection, message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Reload is only allowed on the bus")));
+        return;
+    }
+
+    runIo([this, message, connection]() {
+        // no bus daemon to ask, nobody can be proven to be root
+        QDBusConnectionInterface* bus = connection.interface();
+        if (!bus) {
+            connection.send(message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Only root can reload the configuration")));
+            return;
+        }
+
+        QDBusPendingCallWatcher* watcher = new QDBusPendingCallWatcher(
+            bus->asyncCall(QStringLiteral("GetConnectionUnixUser"), message.service()), this);
+
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, message, connection](QDBusPendingCallWatcher* watcher) {
+            const QDBusPendingReply<uint> uid = *watcher;
+            watcher->deleteLater();
+
+            if (uid.isError() || uid.value() != 0) {
+                qCWarning(lcResourceDaemonCoreLog) << "Config reload denied for" << message.service();
+                connection.send(message.createErrorReply(QDBusError::AccessDenied, QStringLiteral("Only root can reload the configuration")));
+                return;
+            }
+
+            runArbitration([this, message, connection]() {
+                const bool ok = manager()->config()->reload();
+                send(connection, message.createReply(QVariant(ok)));
+            });
+        });
+    });
+}
+
 /**
  * Register a new client.
  * Only allowed senders can register.
  */
-void ManagerAdaptor::registerClient(const QDBusMessage& message, const QDBusConnection& connection)
+void ManagerAdaptor::registerClient(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
 {
-    const auto args = message.arguments();
 
     QVariantList replyArgs;
     ResourceClient* client = nullptr;
@@ -160,27 +459,20 @@ void ManagerAdaptor::registerClient(const QDBusMessage& message, const QDBusConn
         const QString mode = args[8].toString();
         const uint priority = args[9].toUInt();
 
-        client = parent()->createClient(message, priority);
+        client = manager()->createClient(serviceOf(message), priority);
         client->setClientType(type);
-        uint clientId = m_clientsCount + 1;
-        m_clientsCount = m_clientsCount + 1;
-
-        // Register object path on DBus
-        QString path = QString("/org/maemo/resource/client%1")
-                           .arg(clientId);
-        client->setClientID(clientId);
-        client->setObjectPath(path);
-        client->setServiceName(message.service());
-
-        ClientAdaptor* clientAdaptor = new ClientAdaptor(client);
-        bool ok = QDBusConnection::systemBus().registerVirtualObject(
-            path,
-            clientAdaptor);
-
-        if (!ok) {
-            qCWarning(lcResourceDaemonCoreLog) << "Cannot register client object" + path;
+        manager()->setClientClass(client, klass, mode);
+        client->setResourceSet(mandatory, optional, share, mask);
+
+        if (!attachClient(client, connection)) {
+            manager()->destroyClient(client);
             replyArgs << 0 << 0 << 0 << -1 << "Cannot register client object";
         } else {
+            manager()->persistClient(client);
+            if (TrafficTrace* trace = TrafficTrace::instance())
+                trace->recordRegistered(client->clientID());
+            manager()->recorder().record(FlightRecorder::Register, client->clientID(), reqno, mandatory | optional);
+
             replyArgs << (int)9
                       << (uint)client->clientID()
                       << (uint)reqno
@@ -189,115 +481,333 @@ void ManagerAdaptor::registerClient(const QDBusMessage& message, const QDBusConn
         }
     }
 
-    qCDebug(lcResourceDaemonCoreLog) << "==== send messsage ==========";
-    qCDebug(lcResourceDaemonCoreLog) << "Type   : " << replyArgs[0].toInt();
-    qCDebug(lcResourceDaemonCoreLog) << "ID     : " << replyArgs[1].toUInt();
-    qCDebug(lcResourceDaemonCoreLog) << "Req NO : " << replyArgs[2].toUInt();
+    logTrace("send message: type %1 id %2 reqno %3",
+        { quint64(replyArgs[0].toInt()), replyArgs[1].toUInt(), replyArgs[2].toUInt() });
 
+    // send() only queues the reply, the dispatcher never waits for the peer
     QDBusMessage reply = message.createReply(replyArgs);
-    connection.call(reply);
+    send(connection, reply);
 }
 
 /**
- * Unregister a client by object path
+ * Export @client on @connection and route its notifications.
  */
-void ManagerAdaptor::unregisterClient(const QDBusObjectPath& path)
+bool ManagerAdaptor::attachClient(ResourceClient* client, const QDBusConnection& connection)
 {
-    // Lookup client by object path
-    ResourceClient* client = nullptr;
-    for (auto c : parent()->clients()) {
-        if (c->objectPath() == path.path()) {
-            client = c;
-            break;
-        }
+    client->setChannel(m_channel);
+    m_clientConnection = connection;
+
+    // Register object path on DBus
+    const QString path = client->objectPath();
+
+    QDBusConnection bus(connection);
+    if (!bus.registerVirtualObject(path, m_clientAdaptor)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot register client object" + path;
+        return false;
     }
 
+    if (m_peerName.isEmpty())
+        watchService(client->serviceName(), connection);
+
+    return true;
+}
+
+/**
+ * Serve the resource sets ResourceManager::restoreClients() brought back
+ * after a restart. Their owners keep the ids and paths they had.
+ */
+void ManagerAdaptor::restoreClients(const QList<ResourceClient*>& clients, const QDBusConnection& connection)
+{
+    runArbitration([this, clients, connection]() {
+        // each set learns what it holds now, including those that lost a
+        // resource claimed twice before they were exported
+        for (ResourceClient* client : clients) {
+            if (attachClient(client, connection))
+                m_batcher->queueGrant(client, 0, connection);
+            else
+                manager()->destroyClient(client);
+        }
+    });
+}
+
+/**
+ * Unregister a client by resource set id.
+ * Only the bus name that registered it can unregister it.
+ */
+void ManagerAdaptor::unregisterClient(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    const uint rsetId = args.value(1).toUInt(); // ResourceSet id
+    const uint reqno = args.value(2).toUInt();
+
+    ResourceClient* client = manager()->clientById(rsetId);
     if (!client) {
-        qCWarning(lcResourceDaemonCoreLog) <<  "unregisterClient: no such client" + path.path();
+        qCWarning(lcResourceDaemonCoreLog) << "unregisterClient: no such client" << rsetId;
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("No such resource set"));
         return;
     }
 
-    // Only the owner can unregister
-    if (parent()->getMessage().service() != client->objectPath()) {
-        qCWarning(lcResourceDaemonCoreLog) <<  "unregisterClient denied for sender" + parent()->getMessage().service();
+    if (serviceOf(message) != client->serviceName()) {
+        qCWarning(lcResourceDaemonCoreLog) << "unregisterClient denied for sender" << serviceOf(message);
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("Permission denied"));
         return;
     }
 
-    parent()->destroyClient(client);
-    qCDebug(lcResourceDaemonCoreLog) << "Client unregistered:" + path.path();
+    sendStatus(message, connection, rsetId, reqno);
+    manager()->recorder().record(FlightRecorder::Unregister, rsetId, reqno, client->resources());
+
+    const QString service = client->serviceName();
+    const QString path = client->objectPath();
+
+    QDBusConnection bus(connection);
+    bus.unregisterObject(path);
+    manager()->destroyClient(client);
+
+    if (m_peerName.isEmpty() && manager()->clientsForService(service).isEmpty()) {
+        runIo([this, service]() {
+            if (m_watcher)
+                m_watcher->removeWatchedService(service);
+        });
+    }
+
+    qCDebug(lcResourceDaemonCoreLog) << "Client unregistered:" << path;
 }
 
-void ManagerAdaptor::acquireClient(const QDBusMessage& message, const QDBusConnection& connection)
+/**
+ * Start following @service so its resource sets can be reaped when it
+ * drops off the bus. Clients are keyed by unique name, so one watch
+ * covers every resource set of a process; addWatchedService() ignores
+ * services already watched, restored and further sets just repeat it.
+ */
+void ManagerAdaptor::watchService(const QString& service, const QDBusConnection& connection)
 {
-    const auto args = message.arguments();
-    const int resourceType = args[0].toInt(); // usually 3 (event)
-    const uint rsetId = args[1].toUInt(); // ResourceSet id
-    const uint reqno = args[2].toUInt();
-
-    ResourceClient* client = nullptr;
-    for (auto c : parent()->clients()) {
-        if (c->clientID() == rsetId) {
-            client = c;
-            break;
+    // the watcher belongs to the I/O thread
+    runIo([this, service, connection]() {
+        if (!m_watcher) {
+            m_watcher = new QDBusServiceWatcher(this);
+            m_watcher->setConnection(connection);
+            m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+            connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered,
+                this, &ManagerAdaptor::reapService);
         }
-    }
+        m_watcher->addWatchedService(service);
+    });
+}
+
+/**
+ * @service lost its bus name: release all of its resource sets at once.
+ */
+void ManagerAdaptor::reapService(const QString& service)
+{
+    const QDBusConnection bus = m_watcher->connection();
+    m_watcher->removeWatchedService(service);
+
+    runArbitration([this, service, bus]() {
+        reapClients(service, bus);
+    });
+}
+
+void ManagerAdaptor::reapClients(const QString& service, const QDBusConnection& connection)
+{
+    const QList<ResourceClient*> clients = manager()->clientsForService(service);
+
+    if (TrafficTrace* trace = TrafficTrace::instance())
+        trace->recordReap(service);
+
+    QDBusConnection bus(connection);
+    for (ResourceClient* client : clients)
+        bus.unregisterObject(client->objectPath());
+
+    manager()->destroyClientsForService(service);
+
+    qCDebug(lcResourceDaemonCoreLog) << "Peer" << service << "vanished, reaped" << clients.size() << "resource sets";
+}
+
+void ManagerAdaptor::setPeerConnection(const QString& connectionName)
+{
+    m_peerName = connectionName;
+    m_batcher->setPeerToPeer(!connectionName.isEmpty());
+}
+
+/**
+ * The peer-to-peer connection dropped: reap its clients, then retire the
+ * arbitration side of this adaptor. No call is accepted after this, so
+ * the reap is the last job in the mailbox. The arbitration objects are
+ * released once that job has finished, back in this thread.
+ */
+void ManagerAdaptor::peerDisconnected()
+{
+    if (m_closing)
+        return;
+    m_closing = true;
+
+    const QDBusConnection connection(m_peerName);
+
+    runArbitration([this, connection]() {
+        reapClients(m_peerName, connection);
+
+        // grants still pending go out now, later ones would outlive the adaptor
+        disconnect(m_notifier);
+        m_batcher->flush();
+        m_batcher->setSender(nullptr);
+
+        runIo([this]() {
+            // deleted in the arbitration thread, nothing runs there for us anymore
+            m_batcher->deleteLater();
+            m_batcher = nullptr;
+            m_toArbitration->deleteLater();
+            m_toArbitration = nullptr;
+
+            emit peerClosed();
+        });
+    });
+}
+
+void ManagerAdaptor::acquireClient(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    const int resourceType = args.value(0).toInt(); // usually 3 (event)
+    const uint rsetId = args.value(1).toUInt(); // ResourceSet id
+    const uint reqno = args.value(2).toUInt();
+
+    ResourceClient* client = manager()->clientById(rsetId);
     if (!client) {
         qCDebug(lcResourceDaemonCoreLog) << "acquireClient: client not found:" << rsetId;
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("No such resource set"));
         return;
     }
 
-    QVariantList replyArgs;
-    replyArgs << (int)9
-              << (uint)client->clientID()
-              << (uint)reqno
-              << (uint)0
-              << QStringLiteral("OK");
+    if (serviceOf(message) != client->serviceName()) {
+        qCWarning(lcResourceDaemonCoreLog) << "acquireClient denied for sender" << serviceOf(message);
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("Permission denied"));
+        return;
+    }
 
-    QDBusMessage reply = message.createReply(replyArgs);
+    if (answerRetry(client, reqno, message, connection))
+        return;
+
+    sendStatus(message, connection, client->clientID(), reqno);
+    manager()->recorder().record(FlightRecorder::Acquire, client->clientID(), reqno, client->mandatory() | client->optional());
 
-    qCDebug(lcResourceDaemonCoreLog) << "==== send messsage ==========";
-    qCDebug(lcResourceDaemonCoreLog) << "Type   : " << replyArgs[0].toInt();
-    qCDebug(lcResourceDaemonCoreLog) << "ID     : " << replyArgs[1].toUInt();
-    qCDebug(lcResourceDaemonCoreLog) << "Req NO : " << replyArgs[2].toUInt();
+    const ResourcePolicy::ResourceMask granted = manager()->requestResources(client,
+        client->mandatory() | client->optional());
 
-    connection.send(reply);
+    logTrace("ACQUIRE completed for client %1 reqno %2 granted mask %3", { client->clientID(), reqno, granted });
 
-    qCDebug(lcResourceDaemonCoreLog) << "ACQUIRE completed for client" + client->objectPath();
+    m_batcher->queueGrant(client, reqno, connection);
+}
+
+void ManagerAdaptor::releaseClient(const QDBusMessage& message, const QVariantList& args,
+    const QDBusConnection& connection)
+{
+    const uint rsetId = args.value(1).toUInt(); // ResourceSet id
+    const uint reqno = args.value(2).toUInt();
+
+    ResourceClient* client = manager()->clientById(rsetId);
+    if (!client) {
+        qCDebug(lcResourceDaemonCoreLog) << "releaseClient: client not found:" << rsetId;
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("No such resource set"));
+        return;
+    }
+
+    if (serviceOf(message) != client->serviceName()) {
+        qCWarning(lcResourceDaemonCoreLog) << "releaseClient denied for sender" << serviceOf(message);
+        sendStatus(message, connection, rsetId, reqno, (uint)-1, QStringLiteral("Permission denied"));
+        return;
+    }
 
-    if (client->serviceName().isEmpty()) {
-        qCWarning(lcResourceDaemonCoreLog) << "Client serviceName is empty, cannot call grant()";
+    if (answerRetry(client, reqno, message, connection))
         return;
+
+    sendStatus(message, connection, client->clientID(), reqno);
+    manager()->recorder().record(FlightRecorder::Release, client->clientID(), reqno, client->resources());
+
+    manager()->releaseAll(client);
+
+    logTrace("RELEASE completed for client %1 reqno %2", { client->clientID(), reqno });
+
+    m_batcher->queueGrant(client, reqno, connection);
+}
+
+/**
+ * libresource resends a request it got no reply for in time. A retry of a
+ * request already carried out gets the same reply again, without another
+ * arbitration or grant(). Returns false for a new request.
+ */
+bool ManagerAdaptor::answerRetry(ResourceClient* client, uint reqno,
+    const QDBusMessage& message, const QDBusConnection& connection)
+{
+    if (!client->isRecentRequest(reqno)) {
+        client->rememberRequest(reqno);
+        return false;
     }
 
-    QDBusMessage grant = QDBusMessage::createMethodCall(
-        client->serviceName(),
-        client->objectPath(), // /org/maemo/resource/clientX
-        QStringLiteral("org.maemo.resource.client"),
-        QStringLiteral("grant"));
-
-    // grant(int32 rtype, uint32 id, uint32 reqno, uint32 mask)
-    grant << (int)5
-          << (uint)client->clientID()
-          << (uint)reqno
-          << (uint)1024; // обычно mask/share
-
-    connection.send(grant);
-    qCDebug(lcResourceDaemonCoreLog) << "Sent grant() to client:"
-                    << client->objectPath()
-                    << "rtype=" << 5
-                    << "id=" << client->clientID()
-                    << "reqno=" << reqno;
+    manager()->stats().increment(Statistics::Duplicates);
+    logTrace("duplicate request: id %1 reqno %2", { client->clientID(), reqno });
+
+    sendStatus(message, connection, client->clientID(), reqno);
+    return true;
+}
+
+void ManagerAdaptor::runArbitration(Mailbox::Job job)
+{
+    if (m_manager->thread() == QThread::currentThread())
+        job();
+    else
+        m_toArbitration->post(std::move(job));
+}
+
+bool ManagerAdaptor::tryRunArbitration(Mailbox::Job job)
+{
+    if (m_manager->thread() == QThread::currentThread()) {
+        job();
+        return true;
+    }
+    return m_toArbitration->tryPost(std::move(job));
+}
+
+void ManagerAdaptor::runIo(Mailbox::Job job)
+{
+    if (thread() == QThread::currentThread())
+        job();
+    else
+        m_toIo->post(std::move(job));
+}
+
+/**
+ * Marshalling happens in send(), keep it on the I/O thread.
+ */
+void ManagerAdaptor::send(const QDBusConnection& connection, const QDBusMessage& message)
+{
+    runIo([connection, message]() {
+        connection.send(message);
+    });
+}
+
+void ManagerAdaptor::sendStatus(const QDBusMessage& message, const QDBusConnection& connection,
+    uint id, uint reqno, uint error, const QString& errorMessage)
+{
+    QVariantList replyArgs;
+    replyArgs << (int)9
+              << (uint)id
+              << (uint)reqno
+              << (uint)error
+              << errorMessage;
+
+    QDBusMessage reply = message.createReply(replyArgs);
+
+    logTrace("send status: id %1 reqno %2 error %3", { id, reqno, error });
+
+    send(connection, reply);
 }
 
-void ManagerAdaptor::printDebug(const QDBusMessage& message)
+void ManagerAdaptor::printDebug(const QVariantList& args)
 {
-    if (message.arguments().count() < 3) {
+    if (args.count() < 3) {
         qCDebug(lcResourceDaemonCoreLog) << "==== skip system message ===";
         return;
     }
 
-    qCDebug(lcResourceDaemonCoreLog) << "==== got messsage ==========";
-    qCDebug(lcResourceDaemonCoreLog) << "Type   : " << message.arguments()[0].toInt()
-                                     << "ID     : " << message.arguments()[1].toUInt()
-                                     << "Req NO : " << message.arguments()[2].toUInt();
+    logTrace("got message: type %1 id %2 reqno %3",
+        { quint64(args[0].toInt()), args[1].toUInt(), args[2].toUInt() });
 }
@@ -21,37 +21,137 @@
 #define MANAGERADAPTOR_H
 
 #include "core/resourcemanager.h"
+#include "util/mailbox.h"
+#include "util/statistics.h"
+#include <QDBusConnection>
 #include <QDBusContext>
 #include <QDBusObjectPath>
 #include <QDBusVirtualObject>
 #include <QObject>
 
+#include <atomic>
+
+class ClientAdaptor;
+class NotificationBatcher;
+class PeerServer;
+class QDBusServiceWatcher;
+
 /**
  * DBus adaptor for org.maemo.resource.manager
  * Exports methods to system bus.
+ *
+ * The adaptor's thread does the bus I/O: it decodes calls and sends the
+ * replies. Handlers run in the thread of the ResourceManager, both sides
+ * exchange jobs through one Mailbox each way. When both live in the same
+ * thread everything runs inline.
  */
 class ManagerAdaptor : public QDBusVirtualObject {
     Q_OBJECT
 public:
-    explicit ManagerAdaptor(ResourceManager* parent);
+    explicit ManagerAdaptor(ResourceManager* manager, QObject* parent = nullptr);
     ~ManagerAdaptor() override;
-    ResourceManager* parent() const;
+    ResourceManager* manager() const { return m_manager; }
+    NotificationBatcher* batcher() const { return m_batcher; }
+
+    /**
+     * Serve the peer-to-peer connection @connectionName instead of the bus.
+     * Its clients are keyed by the connection name and reaped together
+     * once it disconnects.
+     */
+    void setPeerConnection(const QString& connectionName);
+    QString peerConnection() const { return m_peerName; }
+
+    /**
+     * Address handed out by GetPeerAddress, empty to disable the fast path.
+     */
+    void setPeerAddress(const QString& address) { m_peerAddress = address; }
+
+    /**
+     * Issues the tokens GetPeerAddress hands out and redeems the ones
+     * peer connections present with Authenticate().
+     */
+    void setPeerServer(PeerServer* server) { m_peerServer = server; }
+
+    void restoreClients(const QList<ResourceClient*>& clients, const QDBusConnection& connection);
 
     QString introspect(const QString& path) const override;
     bool handleMessage(const QDBusMessage& message, const QDBusConnection& connection) override;
 
+public Q_SLOTS:
+    void peerDisconnected();
+
 Q_SIGNALS: // SIGNALS
     void ClientRegistered(const QString& client_name, const QDBusObjectPath& client_path);
     void ClientUnregistered(const QDBusObjectPath& client_path);
 
+    // peer-to-peer connection is gone and the adaptor can be deleted
+    void peerClosed();
+
 private:
-    void registerClient(const QDBusMessage& message, const QDBusConnection& connection);
-    void unregisterClient(const QDBusObjectPath& path);
-    void acquireClient(const QDBusMessage& message, const QDBusConnection& connection);
+    using Handler = void (ManagerAdaptor::*)(const QDBusMessage& message, const QVariantList& args,
+        const QDBusConnection& connection);
+
+    // dispatch table entry, the signature is matched as a prefix
+    struct Route {
+        QLatin1String interface;
+        QLatin1String member;
+        QLatin1String signature;
+        Handler handler;
+        Statistics::Method method; // MethodCount: not timed
+    };
+    static const Route s_routes[];
+
+    void registerClient(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void unregisterClient(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void acquireClient(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void releaseClient(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+
+    void getCounters(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void getLatency(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void getPeerAddress(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void reloadConfig(const QDBusMessage& message, const QVariantList& args, const QDBusConnection& connection);
+    void authenticate(const QDBusMessage& message, const QDBusConnection& connection);
+
+    // run @job in the arbitration / I/O thread; tryRunArbitration() refuses
+    // it while the arbitration thread is a full mailbox behind
+    void runArbitration(Mailbox::Job job);
+    bool tryRunArbitration(Mailbox::Job job);
+    void runIo(Mailbox::Job job);
+    void send(const QDBusConnection& connection, const QDBusMessage& message);
+
+    void sendStatus(const QDBusMessage& message, const QDBusConnection& connection,
+        uint id, uint reqno, uint error = 0, const QString& errorMessage = QStringLiteral("OK"));
+
+    bool answerRetry(ResourceClient* client, uint reqno, const QDBusMessage& message, const QDBusConnection& connection);
+    bool attachClient(ResourceClient* client, const QDBusConnection& connection);
+    void watchService(const QString& service, const QDBusConnection& connection);
+    void reapService(const QString& service);
+    void reapClients(const QString& service, const QDBusConnection& connection);
+    QString serviceOf(const QDBusMessage& message) const { return m_peerName.isEmpty() ? message.service() : m_peerName; }
+
+    void printDebug(const QVariantList& args);
+
+    ResourceManager* m_manager;
+    Mailbox* m_toArbitration;
+    Mailbox* m_toIo;
+
+    // arbitration thread
+    NotificationBatcher* m_batcher;
+    QMetaObject::Connection m_notifier;
+    QDBusConnection m_clientConnection;
+
+    // I/O thread
+    QDBusServiceWatcher* m_watcher;
 
-    uint m_clientsCount;
+    // exported at the path of every client this adaptor serves
+    ClientAdaptor* m_clientAdaptor;
+    const quint32 m_channel;
+    std::atomic<bool> m_closing; // peerDisconnected() was called
 
-    void printDebug(const QDBusMessage& message);
+    QString m_peerName;
+    QString m_peerAddress;
+    PeerServer* m_peerServer;
+    bool m_authenticated; // peer connection presented its token, I/O thread
 };
 
 #endif // MANAGERADAPTOR_H
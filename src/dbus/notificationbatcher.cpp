@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "notificationbatcher.h"
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "util/logger.h"
+
+#include <QDBusMessage>
+
+#include <utility>
+
+NotificationBatcher::NotificationBatcher(const ResourceManager* manager, QObject* parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_peerToPeer(false)
+    , m_flushScheduled(false)
+    , m_queued(0)
+    , m_sent(0)
+{
+}
+
+void NotificationBatcher::queueGrant(ResourceClient* client, uint reqno, const QDBusConnection& connection)
+{
+    if (!client)
+        return;
+
+    ++m_queued;
+
+    const uint id = client->clientID();
+    auto it = m_pendingIndex.find(id);
+    if (it == m_pendingIndex.end()) {
+        m_pendingIndex.insert(id, m_pending.size());
+        m_pending.append({ id, reqno, connection, client->resources(), false });
+    } else if (Pending& pending = m_pending[*it]; reqno && pending.reqno && reqno != pending.reqno) {
+        // the earlier request is answered with what it got, libresource
+        // waits for the reqno of each one
+        pending.superseded = true;
+        *it = m_pending.size();
+        m_pending.append({ id, reqno, connection, client->resources(), false });
+    } else {
+        if (reqno)
+            pending.reqno = reqno;
+        pending.resources = client->resources();
+    }
+
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, &NotificationBatcher::flush, Qt::QueuedConnection);
+    }
+}
+
+void NotificationBatcher::flush()
+{
+    m_flushScheduled = false;
+
+    const QList<Pending> pending = std::exchange(m_pending, {});
+    m_pendingIndex.clear();
+
+    for (const Pending& p : pending) {
+        // client may have been destroyed since it was queued
+        if (const ResourceClient* client = m_manager->clientById(p.id))
+            sendGrant(client, p);
+    }
+}
+
+void NotificationBatcher::sendGrant(const ResourceClient* client, const Pending& pending)
+{
+    if (client->serviceName().isEmpty()) {
+        qCWarning(lcResourceDaemonCoreLog) << "Client serviceName is empty, cannot call grant()";
+        return;
+    }
+
+    QDBusMessage grant = QDBusMessage::createMethodCall(
+        m_peerToPeer ? QString() : client->serviceName(),
+        client->objectPath(), // /org/maemo/resource/clientX
+        QStringLiteral("org.maemo.resource.client"),
+        QStringLiteral("grant"));
+
+    const ResourcePolicy::ResourceMask resources = pending.superseded ? pending.resources : client->resources();
+
+    // grant(int32 rtype, uint32 id, uint32 reqno, uint32 mask)
+    grant << (int)5
+          << (uint)client->clientID()
+          << (uint)pending.reqno
+          << (uint)resources;
+
+    if (m_sender)
+        m_sender(pending.connection, grant);
+    else
+        pending.connection.send(grant);
+    ++m_sent;
+
+    qCDebug(lcResourceDaemonCoreLog) << "Sent grant() to client:"
+                    << client->objectPath()
+                    << "rtype=" << 5
+                    << "id=" << client->clientID()
+                    << "reqno=" << pending.reqno
+                    << "resources=" << Qt::hex << resources;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef NOTIFICATIONBATCHER_H
+#define NOTIFICATIONBATCHER_H
+
+#include "core/resourcetypes.h"
+
+#include <QDBusConnection>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+#include <functional>
+
+class ResourceClient;
+class ResourceManager;
+
+/**
+ * Collects ownership changes made while one message is dispatched and
+ * sends at most one libresource grant() per client and request, carrying
+ * the final resource mask, once control is back in the event loop.
+ */
+class NotificationBatcher : public QObject {
+    Q_OBJECT
+
+public:
+    using Sender = std::function<void(const QDBusConnection& connection, const QDBusMessage& message)>;
+
+    explicit NotificationBatcher(const ResourceManager* manager, QObject* parent = nullptr);
+
+    /**
+     * Hand finished grant() calls to @sender instead of sending them here.
+     */
+    void setSender(Sender sender) { m_sender = std::move(sender); }
+
+    /**
+     * Peer-to-peer connections have no bus names, grant() goes out
+     * without a destination then.
+     */
+    void setPeerToPeer(bool peerToPeer) { m_peerToPeer = peerToPeer; }
+
+    /**
+     * Mark @client as changed. A non-zero @reqno is kept so the grant
+     * answers the request that caused the change; a second request of
+     * the same client gets a grant of its own.
+     */
+    void queueGrant(ResourceClient* client, uint reqno, const QDBusConnection& connection);
+
+    // counters
+    quint64 queuedNotifications() const { return m_queued; }
+    quint64 sentMessages() const { return m_sent; }
+    quint64 savedMessages() const { return m_queued - m_sent; }
+
+public slots:
+    void flush();
+
+private:
+    // keyed by id, the client may be gone by the time it is flushed
+    struct Pending {
+        uint id;
+        uint reqno;
+        QDBusConnection connection;
+        ResourcePolicy::ResourceMask resources; // as of the last change it was queued for
+        bool superseded; // a later request followed, send resources instead of the final mask
+    };
+
+    void sendGrant(const ResourceClient* client, const Pending& pending);
+
+    const ResourceManager* m_manager;
+    QList<Pending> m_pending;
+    QHash<uint, qsizetype> m_pendingIndex;
+    Sender m_sender;
+    bool m_peerToPeer;
+    bool m_flushScheduled;
+
+    quint64 m_queued;
+    quint64 m_sent;
+};
+
+#endif // NOTIFICATIONBATCHER_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "peerserver.h"
+#include "dbus/manageradaptor.h"
+#include "util/logger.h"
+
+#include <QDBusConnection>
+#include <QDBusServer>
+#include <QRandomGenerator>
+
+PeerServer::PeerServer(ResourceManager* manager, const QString& objectPath, QObject* parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_objectPath(objectPath)
+    , m_server(nullptr)
+{
+    m_tokenClock.start();
+}
+
+QString PeerServer::address() const
+{
+    return m_server ? m_server->address() : QString();
+}
+
+/**
+ * Token for one connection, valid for TokenLifetime.
+ */
+QString PeerServer::issueToken()
+{
+    quint64 bits[2];
+    QRandomGenerator::system()->fillRange(bits);
+    const QString token = QString::number(bits[0], 16) + QString::number(bits[1], 16);
+
+    QMutexLocker locker(&m_tokenLock);
+    const qint64 now = m_tokenClock.elapsed();
+    m_tokens.removeIf([now](const auto& it) { return it.value() <= now; });
+    m_tokens.insert(token, now + TokenLifetime);
+    return token;
+}
+
+bool PeerServer::redeemToken(const QString& token)
+{
+    QMutexLocker locker(&m_tokenLock);
+    const auto it = m_tokens.constFind(token);
+    if (it == m_tokens.cend())
+        return false;
+
+    const bool valid = it.value() > m_tokenClock.elapsed();
+    m_tokens.erase(it);
+    return valid;
+}
+
+/**
+ * Call in the thread the peer connections are to be served from.
+ */
+bool PeerServer::listen(const QString& address)
+{
+    if (m_server)
+        return m_server->isConnected();
+
+    m_server = new QDBusServer(address, this);
+    if (!m_server->isConnected()) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot listen on" << address << m_server->lastError().message();
+        return false;
+    }
+
+    // any uid may connect, the token decides whether it is served
+    m_server->setAnonymousAuthenticationAllowed(true);
+    connect(m_server, &QDBusServer::newConnection, this, &PeerServer::accept);
+
+    qCDebug(lcResourceDaemonCoreLog) << "Peer-to-peer endpoint at" << m_server->address();
+    return true;
+}
+
+void PeerServer::accept(const QDBusConnection& connection)
+{
+    ManagerAdaptor* adaptor = new ManagerAdaptor(m_manager, this);
+    adaptor->setPeerConnection(connection.name());
+    adaptor->setPeerServer(this);
+
+    connect(adaptor, &ManagerAdaptor::peerClosed, this, [adaptor]() {
+        QDBusConnection::disconnectFromPeer(adaptor->peerConnection());
+        adaptor->deleteLater();
+    });
+
+    QDBusConnection peer(connection);
+    if (!peer.registerVirtualObject(m_objectPath, adaptor)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot serve peer" << connection.name();
+        adaptor->peerDisconnected();
+        return;
+    }
+
+    peer.connect(QString(), QStringLiteral("/org/freedesktop/DBus/Local"),
+        QStringLiteral("org.freedesktop.DBus.Local"), QStringLiteral("Disconnected"),
+        adaptor, SLOT(peerDisconnected()));
+
+    qCDebug(lcResourceDaemonCoreLog) << "Peer connected:" << connection.name();
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PEERSERVER_H
+#define PEERSERVER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+class QDBusConnection;
+class QDBusServer;
+class ResourceManager;
+
+/**
+ * Private socket for latency-critical clients, bypassing dbus-daemon.
+ *
+ * Every accepted connection gets its own ManagerAdaptor speaking the
+ * org.maemo.resource.manager protocol at the usual path, arbitration
+ * state is the one ResourceManager shared with bus clients. Clients learn
+ * the address from GetPeerAddress together with a one-time token. The
+ * socket accepts any uid, a connection is served only after it presented
+ * such a token with Authenticate(), so only callers the bus adaptor
+ * verified get through.
+ */
+class PeerServer : public QObject {
+    Q_OBJECT
+
+public:
+    PeerServer(ResourceManager* manager, const QString& objectPath, QObject* parent = nullptr);
+
+    QString address() const;
+
+    // one-time tokens, called from the bus and the peer I/O threads
+    QString issueToken();
+    bool redeemToken(const QString& token);
+
+    static constexpr qint64 TokenLifetime = 10000; // ms
+
+public slots:
+    bool listen(const QString& address);
+
+private:
+    void accept(const QDBusConnection& connection);
+
+    ResourceManager* m_manager;
+    QString m_objectPath;
+    QDBusServer* m_server;
+
+    QMutex m_tokenLock;
+    QHash<QString, qint64> m_tokens; // token -> expiry on m_tokenClock
+    QElapsedTimer m_tokenClock;
+};
+
+#endif // PEERSERVER_H
@@ -17,12 +17,19 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QThread>
 
 #include "core/resourcemanager.h"
 #include "dbus/manageradaptor.h"
+#include "dbus/peerserver.h"
+#include "util/asynclogger.h"
+#include "util/config.h"
 #include "util/logger.h"
+#include "util/traffictrace.h"
 
 int main(int argc, char* argv[])
 {
@@ -30,28 +37,123 @@ int main(int argc, char* argv[])
     app.setApplicationName("resourced");
     app.setOrganizationName("org.nemomobile");
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption configOption(QStringLiteral("config"),
+        QStringLiteral("Read the configuration from <file>."),
+        QStringLiteral("file"),
+        QStringLiteral(RESOURCED_CONFIG_FILE));
+    parser.addOption(configOption);
+    QCommandLineOption recordOption(QStringLiteral("record"),
+        QStringLiteral("Record the served calls to <file> for resourced-replay."),
+        QStringLiteral("file"));
+    parser.addOption(recordOption);
+    parser.process(app);
+
+    // Core manager, configuration is reloaded on SIGHUP or Config.Reload()
+    ResourceManager* manager = new ResourceManager();
+    Config* config = manager->config();
+    if (!config->load(parser.value(configOption)))
+        qCWarning(lcResourceDaemonCoreLog) << "Using built-in defaults";
+    config->watchSighup();
+
+    // the bus, names and log file are only read at startup
+    const PolicySnapshot* settings = config->snapshot();
+
+    std::unique_ptr<AsyncLogger> logger;
+    if (!settings->logFile.isEmpty()) {
+        logger = std::make_unique<AsyncLogger>(settings->logFile, settings->logMaxSize, settings->logRotations);
+        if (logger->isOpen())
+            logger->install();
+        else
+            qCWarning(lcResourceDaemonCoreLog) << "Cannot open log file" << settings->logFile;
+    }
+
+    // decoded with resourced-flightdump
+    if (!settings->flightRecorder.isEmpty())
+        manager->recorder().open(settings->flightRecorder, settings->flightRecorderSize);
+
+    // record mode
+    TrafficTrace trace;
+    if (parser.isSet(recordOption) && trace.open(parser.value(recordOption))) {
+        trace.install();
+        QObject::connect(manager, &ResourceManager::clientNotified, manager,
+            [&trace](ResourceClient* client, ResourceClient::Event event, ResourcePolicy::ResourceMask resources) {
+                trace.recordNotify(client->clientID(), event, resources);
+            });
+    }
+
     qCDebug(lcResourceDaemonCoreLog) <<  "Starting resourced daemon...";
-    QDBusConnection bus = QDBusConnection::systemBus();
+    QDBusConnection bus = settings->sessionBus ? QDBusConnection::sessionBus() : QDBusConnection::systemBus();
     if (!bus.isConnected()) {
-        qCWarning(lcResourceDaemonCoreLog) << "Cannot connect to system D-Bus:" << bus.lastError().message();
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot connect to D-Bus:" << bus.lastError().message();
         return -1;
     }
 
-    if (!bus.registerService("org.maemo.resource.manager")) {
+    if (!bus.registerService(settings->dbusService)) {
         qCWarning(lcResourceDaemonCoreLog) << "Cannot register D-Bus service:" << bus.lastError().message();
         return -1;
     }
 
-    // Core manager
-    ResourceManager* manager = new ResourceManager();
+    // ownership of the previous run, for peers still on the bus
+    QList<ResourceClient*> restored;
+    if (!settings->stateFile.isEmpty() && manager->store().open(settings->stateFile, settings->stateCapacity)) {
+        const QStringList names = bus.interface()->registeredServiceNames();
+        restored = manager->restoreClients(QSet<QString>(names.cbegin(), names.cend()));
+    }
+
+    const QString path = settings->dbusPath;
+    const bool threaded = settings->threadedDispatch;
+    const QString peerAddress = settings->peerToPeer ? settings->peerAddress : QString();
+
+    // bus I/O in one thread, peer-to-peer I/O in another, arbitration in a
+    // third, main only runs setup
+    QThread ioThread;
+    QThread peerThread;
+    QThread arbitrationThread;
+    if (threaded) {
+        ioThread.setObjectName(QStringLiteral("resourced-io"));
+        peerThread.setObjectName(QStringLiteral("resourced-p2p"));
+        arbitrationThread.setObjectName(QStringLiteral("resourced-arbitration"));
+        manager->moveToThread(&arbitrationThread);
+        arbitrationThread.start();
+    }
+
     ManagerAdaptor adaptor(manager);
+    adaptor.restoreClients(restored, bus);
+    PeerServer peerServer(manager, path);
+    if (threaded) {
+        adaptor.moveToThread(&ioThread);
+        peerServer.moveToThread(&peerThread);
+        ioThread.start();
+        peerThread.start();
+    }
+
+    if (!peerAddress.isEmpty()) {
+        bool listening = false;
+        QMetaObject::invokeMethod(&peerServer, "listen",
+            threaded ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+            Q_RETURN_ARG(bool, listening), Q_ARG(QString, peerAddress));
+        if (listening) {
+            adaptor.setPeerAddress(peerServer.address());
+            adaptor.setPeerServer(&peerServer);
+        }
+    }
 
     if (!bus.registerVirtualObject(
-            "/org/maemo/resource/manager",
+            path,
             &adaptor)) {
-        qCWarning(lcResourceDaemonCoreLog) << "Failed to register virtual object on system bus";
+        qCWarning(lcResourceDaemonCoreLog) << "Failed to register virtual object on D-Bus";
     }
 
     qCDebug(lcResourceDaemonCoreLog) << "resourced started, waiting for clients...";
-    return app.exec();
+    const int result = app.exec();
+
+    bus.unregisterObject(path);
+    for (QThread* thread : { &ioThread, &peerThread, &arbitrationThread }) {
+        thread->quit();
+        thread->wait();
+    }
+
+    return result;
 }
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ARBITRATIONPOLICY_H
+#define ARBITRATIONPOLICY_H
+
+#include "core/resourceclient.h"
+#include "core/resourcetypes.h"
+#include "util/config.h"
+
+/**
+ * Preemption strategies. Each one is a stateless type with inline static
+ * members, so a daemon built for one of them (RESOURCED_POLICY in CMake)
+ * inlines the decision into the arbitration loop. Runtime picks one of
+ * them per call from the [Preemption] Policy setting instead.
+ */
+namespace ArbitrationPolicy {
+
+// higher priority takes, equal or lower never does
+struct StrictPriority {
+    static constexpr PolicyKind kind = PolicyKind::StrictPriority;
+
+    static bool canPreempt(const PolicySnapshot&, const ResourceClient& newClient,
+        const ResourceClient& currentOwner, ResourcePolicy::ResourceMask)
+    {
+        return newClient.priority() > currentOwner.priority();
+    }
+
+    static bool isRuleOverride(const PolicySnapshot&, const ResourceClient&,
+        const ResourceClient&, ResourcePolicy::ResourceMask)
+    {
+        return false;
+    }
+
+    static int rank(const PolicySnapshot&, const ResourceClient& client) { return client.priority(); }
+};
+
+// [PreemptionRules] first, priorities where no rule applies
+struct ClassTable {
+    static constexpr PolicyKind kind = PolicyKind::ClassTable;
+
+    static bool canPreempt(const PolicySnapshot& settings, const ResourceClient& newClient,
+        const ResourceClient& currentOwner, ResourcePolicy::ResourceMask resources)
+    {
+        switch (settings.preemptionRules.decide(newClient.classId(), currentOwner.classId(), resources)) {
+        case PreemptionTable::Allow:
+            return true;
+        case PreemptionTable::Deny:
+            return false;
+        case PreemptionTable::NoRule:
+            break;
+        }
+        return StrictPriority::canPreempt(settings, newClient, currentOwner, resources);
+    }
+
+    // an explicit rule lets @newClient take @resources, priorities are not asked
+    static bool isRuleOverride(const PolicySnapshot& settings, const ResourceClient& newClient,
+        const ResourceClient& currentOwner, ResourcePolicy::ResourceMask resources)
+    {
+        return settings.preemptionRules.decide(newClient.classId(), currentOwner.classId(), resources) == PreemptionTable::Allow;
+    }
+
+    static int rank(const PolicySnapshot&, const ResourceClient& client) { return client.priority(); }
+};
+
+// first come first served: nothing is preempted, waiters are served in order
+struct Fifo {
+    static constexpr PolicyKind kind = PolicyKind::Fifo;
+
+    static bool canPreempt(const PolicySnapshot&, const ResourceClient&,
+        const ResourceClient&, ResourcePolicy::ResourceMask)
+    {
+        return false;
+    }
+
+    static bool isRuleOverride(const PolicySnapshot&, const ResourceClient&,
+        const ResourceClient&, ResourcePolicy::ResourceMask)
+    {
+        return false;
+    }
+
+    static int rank(const PolicySnapshot&, const ResourceClient&) { return 0; }
+};
+
+// one of the above as configured, for development builds
+struct Runtime {
+    static bool canPreempt(const PolicySnapshot& settings, const ResourceClient& newClient,
+        const ResourceClient& currentOwner, ResourcePolicy::ResourceMask resources)
+    {
+        switch (settings.policy) {
+        case PolicyKind::StrictPriority:
+            return StrictPriority::canPreempt(settings, newClient, currentOwner, resources);
+        case PolicyKind::Fifo:
+            return Fifo::canPreempt(settings, newClient, currentOwner, resources);
+        case PolicyKind::ClassTable:
+            break;
+        }
+        return ClassTable::canPreempt(settings, newClient, currentOwner, resources);
+    }
+
+    static bool isRuleOverride(const PolicySnapshot& settings, const ResourceClient& newClient,
+        const ResourceClient& currentOwner, ResourcePolicy::ResourceMask resources)
+    {
+        return settings.policy == PolicyKind::ClassTable
+            && ClassTable::isRuleOverride(settings, newClient, currentOwner, resources);
+    }
+
+    static int rank(const PolicySnapshot& settings, const ResourceClient& client)
+    {
+        return settings.policy == PolicyKind::Fifo ? Fifo::rank(settings, client) : client.priority();
+    }
+};
+
+} // namespace ArbitrationPolicy
+
+// the strategy the daemon is built with
+#if defined(RESOURCED_POLICY_STRICT_PRIORITY)
+using ActivePolicy = ArbitrationPolicy::StrictPriority;
+#elif defined(RESOURCED_POLICY_CLASS_TABLE)
+using ActivePolicy = ArbitrationPolicy::ClassTable;
+#elif defined(RESOURCED_POLICY_FIFO)
+using ActivePolicy = ArbitrationPolicy::Fifo;
+#else
+using ActivePolicy = ArbitrationPolicy::Runtime;
+#endif
+
+#endif // ARBITRATIONPOLICY_H
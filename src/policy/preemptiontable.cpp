@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "preemptiontable.h"
+#include <util/logger.h>
+
+#include <algorithm>
+
+static const QString Wildcard = QStringLiteral("*");
+
+PreemptionTable::PreemptionTable()
+    : m_classes { QString() }
+    , m_entries(1)
+{
+}
+
+PreemptionTable PreemptionTable::compile(const QList<Rule>& rules)
+{
+    PreemptionTable table;
+
+    for (const Rule& rule : rules) {
+        for (const QString& klass : { rule.requester, rule.owner }) {
+            if (klass == Wildcard || table.m_classes.contains(klass))
+                continue;
+            if (table.m_classes.size() == MaxClasses + 1) {
+                qCWarning(lcResourceDaemonCoreLog) << "Too many classes, ignoring" << klass;
+                continue;
+            }
+            table.m_classes << klass;
+        }
+    }
+
+    const int count = int(table.m_classes.size());
+    table.m_entries.assign(count * count, Entry {});
+
+    // wildcards first, so the more specific rule of a pair wins
+    QList<Rule> ordered = rules;
+    std::stable_sort(ordered.begin(), ordered.end(), [](const Rule& a, const Rule& b) {
+        return int(a.requester != Wildcard) + int(a.owner != Wildcard)
+            < int(b.requester != Wildcard) + int(b.owner != Wildcard);
+    });
+
+    for (const Rule& rule : ordered) {
+        const bool anyRequester = rule.requester == Wildcard;
+        const bool anyOwner = rule.owner == Wildcard;
+        const int requester = anyRequester ? -1 : int(table.m_classes.indexOf(rule.requester));
+        const int owner = anyOwner ? -1 : int(table.m_classes.indexOf(rule.owner));
+        if ((!anyRequester && requester < 0) || (!anyOwner && owner < 0))
+            continue;
+
+        for (int r = 0; r < count; ++r) {
+            if (!anyRequester && r != requester)
+                continue;
+            for (int o = 0; o < count; ++o) {
+                if (!anyOwner && o != owner)
+                    continue;
+                table.m_entries[r * count + o] = { rule.resources, true };
+            }
+        }
+    }
+
+    return table;
+}
+
+PreemptionTable::ClassId PreemptionTable::classId(const QString& klass) const
+{
+    const qsizetype id = klass.isEmpty() ? -1 : m_classes.indexOf(klass);
+    return id > 0 ? ClassId(id) : Unclassified;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PREEMPTIONTABLE_H
+#define PREEMPTIONTABLE_H
+
+#include "core/resourcetypes.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+/**
+ * Class rules compiled into a dense (requesting class, owner class) table.
+ * Each entry holds the resources the requester may take from the owner, so
+ * a decision is one lookup no matter how many rules are configured.
+ */
+class PreemptionTable {
+public:
+    // "call>player=AudioPlayback,AudioRecording", "*" matches any class / resource
+    struct Rule {
+        QString requester;
+        QString owner;
+        ResourcePolicy::ResourceMask resources;
+    };
+
+    enum Verdict {
+        NoRule, // no rule for this pair, fall back to priorities
+        Allow,
+        Deny
+    };
+
+    using ClassId = quint8;
+    static constexpr ClassId Unclassified = 0;
+    static constexpr int MaxClasses = 64; // named ones, Unclassified comes on top
+
+    PreemptionTable();
+
+    static PreemptionTable compile(const QList<Rule>& rules);
+
+    /**
+     * Class id of @klass, Unclassified for classes no rule names
+     */
+    ClassId classId(const QString& klass) const;
+    int classCount() const { return int(m_classes.size()); }
+
+    Verdict decide(ClassId requester, ClassId owner, ResourcePolicy::ResourceMask resources) const
+    {
+        // ids resolved against a previous table count as unclassified
+        const qsizetype count = m_classes.size();
+        const Entry& entry = m_entries[(requester < count ? requester : 0) * count + (owner < count ? owner : 0)];
+        if (!entry.ruled)
+            return NoRule;
+        return (entry.allowed & resources) == resources ? Allow : Deny;
+    }
+
+private:
+    struct Entry {
+        ResourcePolicy::ResourceMask allowed = 0;
+        bool ruled = false;
+    };
+
+    // class id → name, id 0 is the unclassified bucket
+    QStringList m_classes;
+    std::vector<Entry> m_entries;
+};
+
+#endif // PREEMPTIONTABLE_H
@@ -18,28 +18,9 @@
  */
 
 #include "prioritypolicy.h"
-#include <core/resourceclient.h>
 
-PriorityPolicy::PriorityPolicy(QObject* parent)
+PriorityPolicy::PriorityPolicy(const Config* config, QObject* parent)
     : QObject(parent)
+    , m_config(config)
 {
 }
-
-bool PriorityPolicy::canPreempt(ResourceClient* newClient,
-    ResourceClient* currentOwner,
-    const QString& resource) const
-{
-    if (!newClient || !currentOwner)
-        return false;
-
-    // Higher priority can preempt lower priority
-    if (newClient->priority() > currentOwner->priority())
-        return true;
-
-    // Same priority → no preemption
-    if (newClient->priority() == currentOwner->priority())
-        return false;
-
-    // Lower priority cannot preempt
-    return false;
-}
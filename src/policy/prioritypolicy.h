@@ -20,22 +20,55 @@
 #ifndef PRIORITYPOLICY_H
 #define PRIORITYPOLICY_H
 
-#include <QObject>
+#include "arbitrationpolicy.h"
+#include "core/resourcetypes.h"
 
-class ResourceClient;
+#include <QObject>
 
+/**
+ * Preemption decisions of the ResourceManager, made by the ActivePolicy
+ * strategy the daemon is built with. Both calls are inline so the
+ * arbitration loop sees the strategy itself.
+ */
 class PriorityPolicy : public QObject {
     Q_OBJECT
 
 public:
-    explicit PriorityPolicy(QObject* parent = nullptr);
+    explicit PriorityPolicy(const Config* config, QObject* parent = nullptr);
+
+    /**
+     * Decide whether @newClient can preempt @currentOwner for @resources.
+     */
+    bool canPreempt(const ResourceClient* newClient,
+        const ResourceClient* currentOwner,
+        ResourcePolicy::ResourceMask resources) const
+    {
+        return newClient && currentOwner
+            && ActivePolicy::canPreempt(*m_config->snapshot(), *newClient, *currentOwner, resources);
+    }
 
     /**
-     * Decide whether @newClient can preempt @currentOwner for @resource
+     * True if a [PreemptionRules] entry, not priorities, lets @newClient
+     * take @resources from @currentOwner.
      */
-    bool canPreempt(ResourceClient* newClient,
-        ResourceClient* currentOwner,
-        const QString& resource) const;
+    bool isRuleOverride(const ResourceClient* newClient,
+        const ResourceClient* currentOwner,
+        ResourcePolicy::ResourceMask resources) const
+    {
+        return newClient && currentOwner
+            && ActivePolicy::isRuleOverride(*m_config->snapshot(), *newClient, *currentOwner, resources);
+    }
+
+    /**
+     * Position of @client in resource wait queues, higher ranks are served first
+     */
+    int rank(const ResourceClient* client) const
+    {
+        return client ? ActivePolicy::rank(*m_config->snapshot(), *client) : 0;
+    }
+
+private:
+    const Config* m_config;
 };
 
 #endif // PRIORITYPOLICY_H
@@ -18,18 +18,18 @@
  */
 
 #include "securitypolicy.h"
+#include <util/config.h>
 
-SecurityPolicy::SecurityPolicy(QObject* parent)
+SecurityPolicy::SecurityPolicy(const Config* config, QObject* parent)
     : QObject(parent)
+    , m_config(config)
 {
-    // TODO: move to config
-    m_whitelist << "org.nemomobile.lipstick";
 }
 
 bool SecurityPolicy::isAllowedSender(const QString& sender) const
 {
-    // Allow only whitelisted system services
-    for (const QString& allowed : m_whitelist) {
+    // Allow only whitelisted system services, [Security] AllowedSenders
+    for (const QString& allowed : m_config->snapshot()->allowedSenders) {
         if (sender == allowed || sender.startsWith(allowed + ".")) {
             return true;
         }
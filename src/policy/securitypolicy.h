@@ -23,11 +23,13 @@
 #include <QObject>
 #include <QString>
 
+class Config;
+
 class SecurityPolicy : public QObject {
     Q_OBJECT
 
 public:
-    explicit SecurityPolicy(QObject* parent = nullptr);
+    explicit SecurityPolicy(const Config* config, QObject* parent = nullptr);
 
     /**
      * Check if the sender (D-Bus service name) is allowed to
@@ -36,7 +38,7 @@ public:
     bool isAllowedSender(const QString& sender) const;
 
 private:
-    QStringList m_whitelist;
+    const Config* m_config;
 };
 
 #endif // SECURITYPOLICY_H
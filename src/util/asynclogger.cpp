@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "asynclogger.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+std::atomic<AsyncLogger*> installed { nullptr };
+QtMessageHandler previousHandler = nullptr;
+
+void messageHandler(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    // the process aborts right after a fatal message, the writer would never see it
+    if (type == QtFatalMsg && previousHandler) {
+        previousHandler(type, context, message);
+        return;
+    }
+
+    AsyncLogger* logger = installed.load(std::memory_order_acquire);
+    if (logger)
+        logger->log(type, context.category ? context.category : "default", message);
+}
+
+char typeLetter(quint8 type)
+{
+    switch (QtMsgType(type)) {
+    case QtDebugMsg:
+        return 'D';
+    case QtInfoMsg:
+        return 'I';
+    case QtWarningMsg:
+        return 'W';
+    case QtCriticalMsg:
+        return 'C';
+    case QtFatalMsg:
+        return 'F';
+    }
+    return '?';
+}
+
+} // namespace
+
+AsyncLogger::AsyncLogger(const QString& path, qint64 maxSize, int rotations)
+    : m_ring(std::make_unique<std::array<Record, Capacity>>())
+    , m_head(0)
+    , m_tail(0)
+    , m_dropped(0)
+    , m_written(0)
+    , m_reportedDropped(0)
+    , m_sleeping(false)
+    , m_wakeups(0)
+    , m_stop(false)
+    , m_file(path)
+    , m_maxSize(maxSize)
+    , m_rotations(rotations)
+{
+    for (int i = 0; i < Capacity; ++i)
+        (*m_ring)[i].sequence.store(i, std::memory_order_relaxed);
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return;
+
+    m_thread = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    if (installed.load() == this) {
+        qInstallMessageHandler(previousHandler);
+        installed.store(nullptr, std::memory_order_release);
+    }
+
+    if (m_thread.joinable()) {
+        m_stop.store(true);
+        m_wakeups.fetch_add(1);
+        m_wakeups.notify_one();
+        m_thread.join();
+    }
+}
+
+void AsyncLogger::install()
+{
+    if (!isOpen())
+        return;
+
+    installed.store(this, std::memory_order_release);
+    previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+AsyncLogger* AsyncLogger::instance()
+{
+    return installed.load(std::memory_order_acquire);
+}
+
+bool AsyncLogger::log(QtMsgType type, const char* category, QStringView text)
+{
+    Record* record = claim();
+    if (!record)
+        return false;
+
+    record->type = type;
+    record->category = category;
+    record->format = nullptr;
+    record->argc = 0;
+    record->length = quint16(std::min<qsizetype>(text.size(), TextChars));
+    std::memcpy(record->text, text.utf16(), record->length * sizeof(char16_t));
+
+    publish(record);
+    return true;
+}
+
+bool AsyncLogger::trace(QtMsgType type, const char* category, const char* format,
+    std::initializer_list<quint64> args)
+{
+    Record* record = claim();
+    if (!record)
+        return false;
+
+    record->type = type;
+    record->category = category;
+    record->format = format;
+    record->argc = quint8(std::min<std::size_t>(args.size(), MaxArgs));
+    std::copy_n(args.begin(), record->argc, record->args);
+    record->length = 0;
+
+    publish(record);
+    return true;
+}
+
+/* private */
+
+/**
+ * Reserve the next free slot, nullptr if the writer is a full ring behind.
+ */
+AsyncLogger::Record* AsyncLogger::claim()
+{
+    quint64 position = m_head.load(std::memory_order_relaxed);
+    for (;;) {
+        Record& record = (*m_ring)[position & (Capacity - 1)];
+        const qint64 lag = qint64(record.sequence.load(std::memory_order_acquire)) - qint64(position);
+
+        if (lag == 0) {
+            if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                record.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                                       .count();
+                return &record;
+            }
+        } else if (lag < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            position = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogger::publish(Record* record)
+{
+    const quint64 position = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(position + 1, std::memory_order_release);
+
+    // only pay for a wakeup when the writer is idle; pairs with the fence
+    // in run(): either the writer sees this record or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        m_wakeups.fetch_add(1);
+        m_wakeups.notify_one();
+    }
+}
+
+void AsyncLogger::run()
+{
+    for (;;) {
+        const bool stopping = m_stop.load();
+        drain();
+        if (stopping)
+            break;
+
+        const quint32 wakeups = m_wakeups.load();
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const Record& next = (*m_ring)[m_tail & (Capacity - 1)];
+        if (next.sequence.load(std::memory_order_acquire) != m_tail + 1 && !m_stop.load())
+            m_wakeups.wait(wakeups);
+        m_sleeping.store(false);
+    }
+
+    m_file.close();
+}
+
+bool AsyncLogger::drain()
+{
+    bool any = false;
+
+    for (;;) {
+        Record& record = (*m_ring)[m_tail & (Capacity - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != m_tail + 1)
+            break;
+
+        write(record);
+        record.sequence.store(m_tail + Capacity, std::memory_order_release);
+        ++m_tail;
+        any = true;
+    }
+
+    const quint64 dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped) {
+        m_file.write(QStringLiteral("%1 W resourced: %2 log records dropped\n")
+                         .arg(QDateTime::currentDateTime().toString(Qt::ISODateWithMs))
+                         .arg(dropped - m_reportedDropped)
+                         .toUtf8());
+        m_reportedDropped = dropped;
+        any = true;
+    }
+
+    if (any)
+        m_file.flush();
+
+    return any;
+}
+
+void AsyncLogger::write(const Record& record)
+{
+    QString text;
+    if (record.format) {
+        text = QString::fromLatin1(record.format);
+        for (int i = 0; i < record.argc; ++i)
+            text = text.arg(record.args[i]);
+    } else {
+        text = QString::fromUtf16(record.text, record.length);
+    }
+
+    const QByteArray line = QStringLiteral("%1 %2 %3: %4\n")
+                                .arg(QDateTime::fromMSecsSinceEpoch(record.timestamp).toString(Qt::ISODateWithMs))
+                                .arg(QLatin1Char(typeLetter(record.type)))
+                                .arg(QLatin1String(record.category), text)
+                                .toUtf8();
+
+    if (m_maxSize > 0 && m_file.size() + line.size() > m_maxSize)
+        rotate();
+
+    m_file.write(line);
+    m_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * resourced.log → resourced.log.1 → ... → resourced.log.<rotations>, the last one is dropped.
+ */
+void AsyncLogger::rotate()
+{
+    const QString path = m_file.fileName();
+    m_file.close();
+
+    QFile::remove(QStringLiteral("%1.%2").arg(path).arg(m_rotations));
+    for (int i = m_rotations - 1; i >= 1; --i)
+        QFile::rename(QStringLiteral("%1.%2").arg(path).arg(i), QStringLiteral("%1.%2").arg(path).arg(i + 1));
+    if (m_rotations > 0)
+        QFile::rename(path, path + QStringLiteral(".1"));
+    else
+        QFile::remove(path);
+
+    m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QFile>
+#include <QString>
+#include <QStringView>
+
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+
+/**
+ * Log file writer that keeps I/O off the dispatch thread.
+ *
+ * Producers copy a fixed-size binary record into a bounded lock-free ring
+ * (Vyukov MPMC queue, used with a single consumer). A background thread
+ * formats the records, appends them to the log file and rotates it by size.
+ * A full ring drops the record and counts it, producers never block.
+ */
+class AsyncLogger {
+public:
+    static constexpr int Capacity = 2048; // records, power of two
+    static constexpr int TextChars = 96; // longer messages are truncated
+    static constexpr int MaxArgs = 4;
+
+    AsyncLogger(const QString& path, qint64 maxSize, int rotations);
+    ~AsyncLogger();
+
+    bool isOpen() const { return m_file.isOpen(); }
+
+    /**
+     * Route Qt messages through this logger until it is destroyed.
+     */
+    void install();
+    static AsyncLogger* instance();
+
+    // hot path, false if the ring was full and the record got dropped
+    bool log(QtMsgType type, const char* category, QStringView text);
+
+    /**
+     * Record @format with up to four numbers for %1..%4, formatted later by
+     * the writer thread. @format must be a string literal.
+     */
+    bool trace(QtMsgType type, const char* category, const char* format, std::initializer_list<quint64> args);
+
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    quint64 written() const { return m_written.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Record {
+        std::atomic<quint64> sequence;
+        qint64 timestamp; // ms since epoch
+        const char* category;
+        const char* format; // trace record when set
+        quint64 args[MaxArgs];
+        quint8 type;
+        quint8 argc;
+        quint16 length;
+        char16_t text[TextChars];
+    };
+
+    Record* claim();
+    void publish(Record* record);
+
+    void run();
+    bool drain();
+    void write(const Record& record);
+    void rotate();
+
+    std::unique_ptr<std::array<Record, Capacity>> m_ring;
+    alignas(64) std::atomic<quint64> m_head;
+    alignas(64) quint64 m_tail; // writer thread only
+
+    std::atomic<quint64> m_dropped;
+    std::atomic<quint64> m_written;
+    quint64 m_reportedDropped;
+
+    // the writer sleeps on m_wakeups while m_sleeping is set
+    std::atomic<bool> m_sleeping;
+    std::atomic<quint32> m_wakeups;
+    std::atomic<bool> m_stop;
+
+    QFile m_file;
+    qint64 m_maxSize;
+    int m_rotations;
+
+    std::thread m_thread;
+};
+
+#endif // ASYNCLOGGER_H
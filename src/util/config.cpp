@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include "logger.h"
+
+#include <QFileInfo>
+#include <QSettings>
+#include <QSocketNotifier>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+int sighupFds[2] = { -1, -1 };
+
+void sighupHandler(int)
+{
+    const char wake = 1;
+    [[maybe_unused]] const ssize_t written = ::write(sighupFds[0], &wake, sizeof(wake));
+}
+
+QtMsgType parseLogLevel(const QString& level, QtMsgType fallback)
+{
+    if (level.compare(QLatin1String("Debug"), Qt::CaseInsensitive) == 0)
+        return QtDebugMsg;
+    if (level.compare(QLatin1String("Info"), Qt::CaseInsensitive) == 0)
+        return QtInfoMsg;
+    if (level.compare(QLatin1String("Warning"), Qt::CaseInsensitive) == 0)
+        return QtWarningMsg;
+    if (level.compare(QLatin1String("Critical"), Qt::CaseInsensitive) == 0)
+        return QtCriticalMsg;
+    return fallback;
+}
+
+} // namespace
+
+Config::Config(QObject* parent)
+    : QObject(parent)
+    , m_sighupNotifier(nullptr)
+{
+    m_current.storeRelease(new PolicySnapshot);
+}
+
+Config::~Config()
+{
+    delete m_current.loadAcquire();
+}
+
+bool Config::load(const QString& path)
+{
+    m_path = path;
+
+    std::unique_ptr<PolicySnapshot> snapshot = parse(path);
+    if (!snapshot)
+        return false;
+
+    publish(std::move(snapshot));
+
+    qCDebug(lcResourceDaemonCoreLog) << "Loaded" << path << "generation" << this->snapshot()->generation;
+    emit reloaded();
+    return true;
+}
+
+bool Config::watchSighup()
+{
+    if (m_sighupNotifier)
+        return true;
+
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sighupFds) != 0) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot create SIGHUP socket pair";
+        return false;
+    }
+
+    m_sighupNotifier = new QSocketNotifier(sighupFds[1], QSocketNotifier::Read, this);
+    connect(m_sighupNotifier, &QSocketNotifier::activated, this, [this]() {
+        char wake;
+        [[maybe_unused]] const ssize_t got = ::read(sighupFds[1], &wake, sizeof(wake));
+        qCInfo(lcResourceDaemonCoreLog) << "SIGHUP, reloading" << m_path;
+        reload();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = sighupHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    return ::sigaction(SIGHUP, &action, nullptr) == 0;
+}
+
+/* private */
+
+std::unique_ptr<PolicySnapshot> Config::parse(const QString& path) const
+{
+    if (path.isEmpty() || !QFileInfo::exists(path)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Config file not found:" << path;
+        return nullptr;
+    }
+
+    QSettings settings(path, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot parse config file" << path;
+        return nullptr;
+    }
+
+    const PolicySnapshot defaults;
+    auto snapshot = std::make_unique<PolicySnapshot>();
+
+    settings.beginGroup(QStringLiteral("General"));
+    snapshot->dbusService = settings.value(QStringLiteral("DBusService"), defaults.dbusService).toString();
+    snapshot->dbusPath = settings.value(QStringLiteral("DBusPath"), defaults.dbusPath).toString();
+    snapshot->logFile = settings.value(QStringLiteral("LogFile")).toString();
+    snapshot->logMaxSize = settings.value(QStringLiteral("LogMaxSize"), defaults.logMaxSize).toLongLong();
+    snapshot->logRotations = settings.value(QStringLiteral("LogRotations"), defaults.logRotations).toInt();
+    snapshot->flightRecorder = settings.value(QStringLiteral("FlightRecorder"), defaults.flightRecorder).toString();
+    snapshot->flightRecorderSize = settings.value(QStringLiteral("FlightRecorderSize"), defaults.flightRecorderSize).toUInt();
+    snapshot->stateFile = settings.value(QStringLiteral("StateFile"), defaults.stateFile).toString();
+    snapshot->stateCapacity = settings.value(QStringLiteral("StateCapacity"), defaults.stateCapacity).toUInt();
+    snapshot->logLevel = parseLogLevel(settings.value(QStringLiteral("LogLevel")).toString(), defaults.logLevel);
+    snapshot->defaultClientPriority = settings.value(QStringLiteral("DefaultClientPriority"), defaults.defaultClientPriority).toInt();
+    snapshot->threadedDispatch = settings.value(QStringLiteral("ThreadedDispatch"), defaults.threadedDispatch).toBool();
+    snapshot->sessionBus = settings.value(QStringLiteral("Bus")).toString().compare(QLatin1String("Session"), Qt::CaseInsensitive) == 0;
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("Security"));
+    if (settings.contains(QStringLiteral("AllowedSenders"))) {
+        snapshot->allowedSenders.clear();
+        const QStringList senders = settings.value(QStringLiteral("AllowedSenders")).toStringList();
+        for (QString sender : senders) {
+            sender = sender.trimmed();
+            if (sender.endsWith(QLatin1String(".*")))
+                sender.chop(2);
+            if (!sender.isEmpty())
+                snapshot->allowedSenders << sender;
+        }
+    }
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("PeerToPeer"));
+    snapshot->peerToPeer = settings.value(QStringLiteral("Enable"), defaults.peerToPeer).toBool();
+    snapshot->peerAddress = settings.value(QStringLiteral("Address"), defaults.peerAddress).toString();
+    settings.endGroup();
+
+    settings.beginGroup(QStringLiteral("Preemption"));
+    snapshot->enablePreemption = settings.value(QStringLiteral("EnablePreemption"), defaults.enablePreemption).toBool();
+    const QString policy = settings.value(QStringLiteral("Policy")).toString();
+    if (policy == QLatin1String("strict-priority"))
+        snapshot->policy = PolicyKind::StrictPriority;
+    else if (policy == QLatin1String("fifo"))
+        snapshot->policy = PolicyKind::Fifo;
+    else if (!policy.isEmpty() && policy != QLatin1String("class-table"))
+        qCWarning(lcResourceDaemonCoreLog) << "Unknown preemption policy" << policy;
+    snapshot->minHoldTime = settings.value(QStringLiteral("MinHoldTime"), defaults.minHoldTime).toInt();
+    snapshot->pairPreemptionLimit = settings.value(QStringLiteral("PairPreemptionLimit"), defaults.pairPreemptionLimit).toInt();
+    snapshot->pairPreemptionWindow = settings.value(QStringLiteral("PairPreemptionWindow"), defaults.pairPreemptionWindow).toInt();
+    snapshot->dampingPriorityBand = settings.value(QStringLiteral("DampingPriorityBand"), defaults.dampingPriorityBand).toInt();
+    settings.endGroup();
+
+    // requester>owner=resources
+    QList<PreemptionTable::Rule> rules;
+    settings.beginGroup(QStringLiteral("PreemptionRules"));
+    const QStringList keys = settings.childKeys();
+    for (const QString& key : keys) {
+        const QStringList classes = key.split(QLatin1Char('>'));
+        if (classes.size() != 2 || classes[0].trimmed().isEmpty() || classes[1].trimmed().isEmpty()) {
+            qCWarning(lcResourceDaemonCoreLog) << "Ignoring malformed preemption rule" << key;
+            continue;
+        }
+
+        ResourcePolicy::ResourceMask resources = 0;
+        const QStringList names = settings.value(key).toStringList();
+        for (const QString& value : names) {
+            // an empty list never lets the requester preempt the owner
+            const QString name = value.trimmed();
+            if (name.isEmpty())
+                continue;
+            if (name == QLatin1String("*")) {
+                resources = ~ResourcePolicy::ResourceMask(0);
+                continue;
+            }
+            const ResourcePolicy::ResourceAtom atom = ResourcePolicy::intern(name);
+            if (atom == ResourcePolicy::InvalidAtom)
+                qCWarning(lcResourceDaemonCoreLog) << "Unknown resource" << name << "in rule" << key;
+            else
+                resources |= ResourcePolicy::maskOf(atom);
+        }
+
+        rules.append({ classes[0].trimmed(), classes[1].trimmed(), resources });
+    }
+    settings.endGroup();
+    snapshot->preemptionRules = PreemptionTable::compile(rules);
+
+    return snapshot;
+}
+
+void Config::publish(std::unique_ptr<PolicySnapshot> snapshot)
+{
+    const PolicySnapshot* previous = m_current.loadAcquire();
+    snapshot->generation = previous->generation + 1;
+
+    m_current.storeRelease(snapshot.release());
+
+    // readers may still look at the previous one during this iteration
+    m_retired.reset(previous);
+
+    setLogLevel(this->snapshot()->logLevel);
+}
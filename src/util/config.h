@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <policy/preemptiontable.h>
+
+#include <QAtomicPointer>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class QSocketNotifier;
+
+// preemption strategy, see policy/arbitrationpolicy.h
+enum class PolicyKind {
+    ClassTable,
+    StrictPriority,
+    Fifo
+};
+
+/**
+ * Parsed resourced.conf.
+ * Never modified once published, a reload publishes a new one.
+ */
+struct PolicySnapshot {
+    // [General]
+    QString dbusService = QStringLiteral("org.maemo.resource.manager");
+    QString dbusPath = QStringLiteral("/org/maemo/resource/manager");
+    QString logFile;
+    qint64 logMaxSize = 1024 * 1024;
+    int logRotations = 3;
+    QString flightRecorder = QStringLiteral("/run/resourced/flightrecorder");
+    quint32 flightRecorderSize = 8192; // records
+    QString stateFile = QStringLiteral("/run/resourced/state");
+    quint32 stateCapacity = 1024; // clients
+    QtMsgType logLevel = QtWarningMsg;
+    int defaultClientPriority = 0;
+    bool sessionBus = false;
+    bool threadedDispatch = true;
+
+    // [Security], prefixes: "org.nemomobile.*" is stored as "org.nemomobile"
+    QStringList allowedSenders = { QStringLiteral("org.nemomobile.lipstick") };
+
+    // [PeerToPeer]
+    bool peerToPeer = false;
+    QString peerAddress = QStringLiteral("unix:path=/run/resourced/p2p");
+
+    // [Preemption]
+    bool enablePreemption = true;
+    PolicyKind policy = PolicyKind::ClassTable; // only with RESOURCED_POLICY=runtime
+    int minHoldTime = 0; // ms a new owner keeps a resource before it can be preempted
+    int pairPreemptionLimit = 0; // preemptions between two clients per window, 0: unlimited
+    int pairPreemptionWindow = 1000; // ms
+    int dampingPriorityBand = 0; // both limits only apply between clients whose ranks differ at most this much
+
+    // [PreemptionRules]
+    PreemptionTable preemptionRules;
+
+    quint64 generation = 0;
+};
+
+/**
+ * Owner of the current PolicySnapshot.
+ * Readers get the snapshot with one atomic load and no lock. They must not
+ * keep the pointer across event loop iterations: the replaced snapshot is
+ * only kept alive until the next reload.
+ */
+class Config : public QObject {
+    Q_OBJECT
+
+public:
+    explicit Config(QObject* parent = nullptr);
+    ~Config() override;
+
+    const PolicySnapshot* snapshot() const { return m_current.loadAcquire(); }
+    QString path() const { return m_path; }
+
+    /**
+     * Parse @path and publish it. On failure the current snapshot stays.
+     */
+    bool load(const QString& path);
+    bool reload() { return load(m_path); }
+
+    /**
+     * Reload on SIGHUP, from the event loop.
+     */
+    bool watchSighup();
+
+signals:
+    void reloaded();
+
+private:
+    std::unique_ptr<PolicySnapshot> parse(const QString& path) const;
+    void publish(std::unique_ptr<PolicySnapshot> snapshot);
+
+    QString m_path;
+    QAtomicPointer<const PolicySnapshot> m_current;
+    std::unique_ptr<const PolicySnapshot> m_retired;
+    QSocketNotifier* m_sighupNotifier;
+};
+
+#endif // CONFIG_H
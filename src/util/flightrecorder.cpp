@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "flightrecorder.h"
+#include "logger.h"
+
+#include <QFile>
+
+#include <bit>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const EventNames[FlightRecorder::EventCount] = {
+    "start",
+    "register",
+    "unregister",
+    "acquire",
+    "release",
+    "grant",
+    "deny",
+    "preempt",
+    "handoff",
+    "reap",
+    "restore",
+};
+
+FlightRecorder::FlightRecorder()
+    : m_header(nullptr)
+    , m_records(nullptr)
+    , m_mask(0)
+    , m_size(0)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if (m_header)
+        ::munmap(m_header, m_size);
+}
+
+bool FlightRecorder::open(const QString& path, quint32 capacity)
+{
+    if (m_header || !capacity)
+        return false;
+
+    capacity = std::bit_ceil(capacity);
+    const std::size_t size = sizeof(Header) + std::size_t(capacity) * sizeof(Record);
+
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot open flight recorder" << path;
+        return false;
+    }
+
+    // a file of another size is another geometry, start from zeroes
+    struct stat info;
+    const bool resize = ::fstat(fd, &info) != 0 || std::size_t(info.st_size) != size;
+    if (resize && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, off_t(size)) != 0)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot size flight recorder" << path;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot map flight recorder" << path;
+        return false;
+    }
+
+    m_header = static_cast<Header*>(mapping);
+    m_records = reinterpret_cast<Record*>(static_cast<char*>(mapping) + sizeof(Header));
+    m_mask = capacity - 1;
+    m_size = size;
+
+    // a ring left behind by a previous run is continued, anything else starts over
+    const bool valid = std::memcmp(m_header->magic, Magic, sizeof(Magic)) == 0
+        && m_header->version == Version
+        && m_header->recordSize == sizeof(Record)
+        && m_header->capacity == capacity;
+    if (!valid) {
+        std::memset(mapping, 0, size);
+        std::memcpy(m_header->magic, Magic, sizeof(Magic));
+        m_header->version = Version;
+        m_header->recordSize = sizeof(Record);
+        m_header->capacity = capacity;
+    }
+
+    append(Start, quint32(::getpid()), 0, 0, 0);
+    return true;
+}
+
+const char* FlightRecorder::eventName(quint8 event)
+{
+    return event < EventCount ? EventNames[event] : "unknown";
+}
+
+/* private */
+
+void FlightRecorder::append(Event event, quint32 client, quint32 reqno, quint32 resources, quint32 other)
+{
+    const quint64 number = m_header->head.fetch_add(1, std::memory_order_relaxed);
+    Record& record = m_records[number & m_mask];
+
+    timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+
+    // readers skip the slot while the sequence is 0; the fence keeps the
+    // payload stores below from becoming visible before it
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.timestamp = quint64(now.tv_sec) * 1000000000 + quint64(now.tv_nsec);
+    record.event = event;
+    record.client = client;
+    record.other = other;
+    record.reqno = reqno;
+    record.resources = resources;
+    record.sequence.store(quint32(number) + 1, std::memory_order_release);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+/**
+ * Always-on ring of binary arbitration events in a memory-mapped file.
+ *
+ * The mapping is shared with the page cache, so whatever was recorded
+ * survives a daemon crash and is read back by resourced-flightdump. A
+ * restarted daemon keeps appending to the same ring.
+ */
+class FlightRecorder {
+public:
+    enum Event : quint8 {
+        Start,
+        Register,
+        Unregister,
+        Acquire,
+        Release,
+        Grant,
+        Deny,
+        Preempt, // client lost resources to other
+        Handoff,
+        Reap,
+        Restore,
+        EventCount
+    };
+
+    // file layout, version 1
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 recordSize;
+        quint32 capacity; // records, power of two
+        quint32 reserved;
+        std::atomic<quint64> head; // records ever written
+    };
+
+    struct Record {
+        quint64 timestamp; // ns since epoch
+        std::atomic<quint32> sequence; // low bits of the record number + 1, 0 while being written
+        quint8 event;
+        quint8 reserved[3];
+        quint32 client;
+        quint32 other;
+        quint32 reqno;
+        quint32 resources;
+    };
+    static_assert(sizeof(Record) == 32);
+
+    static constexpr char Magic[8] = { 'R', 'D', 'F', 'L', 'I', 'G', 'H', 'T' };
+    static constexpr quint32 Version = 1;
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    /**
+     * Map @path with room for @capacity records, rounded up to a power
+     * of two. An existing ring with the same geometry is continued.
+     */
+    bool open(const QString& path, quint32 capacity);
+    bool isOpen() const { return m_header; }
+
+    void record(Event event, quint32 client, quint32 reqno = 0,
+        quint32 resources = 0, quint32 other = 0)
+    {
+        if (m_header)
+            append(event, client, reqno, resources, other);
+    }
+
+    static const char* eventName(quint8 event);
+
+private:
+    void append(Event event, quint32 client, quint32 reqno, quint32 resources, quint32 other);
+
+    Header* m_header;
+    Record* m_records;
+    quint64 m_mask;
+    std::size_t m_size;
+};
+
+#endif // FLIGHTRECORDER_H
@@ -18,4 +18,52 @@
  */
 
 #include "logger.h"
+#include "asynclogger.h"
+
 Q_LOGGING_CATEGORY(lcResourceDaemonCoreLog, "org.glacier.resourced", QtWarningMsg)
+
+// QtMsgType is not ordered by severity, QtInfoMsg comes last
+static int severity(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return 0;
+    case QtInfoMsg:
+        return 1;
+    case QtWarningMsg:
+        return 2;
+    case QtCriticalMsg:
+        return 3;
+    case QtFatalMsg:
+        return 4;
+    }
+    return 2;
+}
+
+void setLogLevel(QtMsgType level)
+{
+    const auto enabled = [level](QtMsgType type) {
+        return severity(type) >= severity(level) ? QLatin1String("true") : QLatin1String("false");
+    };
+
+    QLoggingCategory::setFilterRules(QStringLiteral("org.glacier.resourced.debug=%1\n"
+                                                    "org.glacier.resourced.info=%2\n"
+                                                    "org.glacier.resourced.warning=%3")
+            .arg(enabled(QtDebugMsg), enabled(QtInfoMsg), enabled(QtWarningMsg)));
+}
+
+void logTrace(const char* format, std::initializer_list<quint64> args)
+{
+    if (!lcResourceDaemonCoreLog().isDebugEnabled())
+        return;
+
+    if (AsyncLogger* logger = AsyncLogger::instance()) {
+        logger->trace(QtDebugMsg, lcResourceDaemonCoreLog().categoryName(), format, args);
+        return;
+    }
+
+    QString text = QString::fromLatin1(format);
+    for (quint64 arg : args)
+        text = text.arg(arg);
+    qCDebug(lcResourceDaemonCoreLog).noquote() << text;
+}
@@ -22,6 +22,20 @@
 
 #include <QLoggingCategory>
 
+#include <initializer_list>
+
 Q_DECLARE_LOGGING_CATEGORY(lcResourceDaemonCoreLog)
 
+/**
+ * Enable messages of @level and above.
+ */
+void setLogLevel(QtMsgType level);
+
+/**
+ * Debug message for the request path: with the async logger running only
+ * @format (a string literal, %1..%4) and the numbers are recorded,
+ * formatting happens on the writer thread.
+ */
+void logTrace(const char* format, std::initializer_list<quint64> args);
+
 #endif // LOGGER_H
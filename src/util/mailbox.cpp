@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "mailbox.h"
+#include "logger.h"
+
+#include <QMutexLocker>
+#include <QSocketNotifier>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+Mailbox::Mailbox(QObject* parent)
+    : QObject(parent)
+    , m_armed(false)
+    , m_posted(0)
+    , m_overflowed(0)
+    , m_rejected(0)
+    , m_overflowing(false)
+    , m_eventFd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_notifier(new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this))
+{
+    connect(m_notifier, &QSocketNotifier::activated, this, &Mailbox::drain);
+}
+
+Mailbox::~Mailbox()
+{
+    ::close(m_eventFd);
+}
+
+void Mailbox::post(Job job)
+{
+    if (m_overflowing.load(std::memory_order_acquire) || !m_queue.push(std::move(job))) {
+        // the consumer is a full queue behind, never wait for it
+        QMutexLocker locker(&m_overflowLock);
+        m_overflow.push_back(std::move(job));
+        m_overflowing.store(true, std::memory_order_release);
+        m_overflowed.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    wake();
+}
+
+/**
+ * Like post(), but refuses @job while the consumer is a full queue behind.
+ */
+bool Mailbox::tryPost(Job job)
+{
+    if (m_overflowing.load(std::memory_order_acquire) || !m_queue.push(std::move(job))) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    wake();
+    return true;
+}
+
+/* private */
+
+void Mailbox::wake()
+{
+    // one wakeup per batch: the consumer disarms before it drains
+    if (!m_armed.exchange(true)) {
+        const quint64 one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(m_eventFd, &one, sizeof(one));
+    }
+}
+
+void Mailbox::drain()
+{
+    quint64 count;
+    [[maybe_unused]] const ssize_t got = ::read(m_eventFd, &count, sizeof(count));
+    m_armed.store(false);
+
+    // a bounded batch keeps the rest of the event loop responsive
+    for (std::size_t i = 0; i < Capacity; ++i) {
+        std::optional<Job> job = m_queue.pop();
+        if (!job) {
+            // everything in the queue is older than the overflow
+            if (!m_overflowing.load(std::memory_order_acquire))
+                return;
+
+            std::deque<Job> overflow;
+            {
+                QMutexLocker locker(&m_overflowLock);
+                overflow.swap(m_overflow);
+                m_overflowing.store(false, std::memory_order_release);
+            }
+            for (Job& pending : overflow)
+                pending();
+            break;
+        }
+        (*job)();
+    }
+
+    wake();
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include "spscqueue.h"
+
+#include <QMutex>
+#include <QObject>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+
+class QSocketNotifier;
+
+/**
+ * One-way channel of jobs from one producer thread to the thread this
+ * object lives in. Jobs go through an SpscQueue; the consumer is woken
+ * through an eventfd only when it may be idle, so neither side takes a
+ * lock.
+ *
+ * post() never blocks: once the queue is full, jobs go to an overflow list
+ * behind a mutex until the consumer has caught up. tryPost() refuses the
+ * job instead, for producers that can push back on their own callers.
+ */
+class Mailbox : public QObject {
+    Q_OBJECT
+
+public:
+    using Job = std::function<void()>;
+    static constexpr std::size_t Capacity = 1024;
+
+    explicit Mailbox(QObject* parent = nullptr);
+    ~Mailbox() override;
+
+    // producer thread only
+    void post(Job job);
+    bool tryPost(Job job);
+
+    quint64 posted() const { return m_posted.load(std::memory_order_relaxed); }
+    quint64 overflowed() const { return m_overflowed.load(std::memory_order_relaxed); }
+    quint64 rejected() const { return m_rejected.load(std::memory_order_relaxed); }
+
+private:
+    void wake();
+    void drain();
+
+    SpscQueue<Job, Capacity> m_queue;
+    std::atomic<bool> m_armed;
+    std::atomic<quint64> m_posted;
+    std::atomic<quint64> m_overflowed;
+    std::atomic<quint64> m_rejected;
+
+    // jobs posted while the queue was full, in order; set while non-empty
+    // so later jobs queue up behind them
+    QMutex m_overflowLock;
+    std::deque<Job> m_overflow;
+    std::atomic<bool> m_overflowing;
+
+    int m_eventFd;
+    QSocketNotifier* m_notifier;
+};
+
+#endif // MAILBOX_H
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ownershipstore.h"
+#include "logger.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char Magic[8] = { 'R', 'D', 'S', 'T', 'A', 'T', 'E', 0 };
+constexpr quint32 Version = 1;
+
+template <std::size_t N>
+quint8 copyString(char (&target)[N], const QString& value)
+{
+    const QByteArray bytes = value.toUtf8();
+    const std::size_t length = std::min<std::size_t>(bytes.size(), N);
+    std::memcpy(target, bytes.constData(), length);
+    return quint8(length);
+}
+
+} // namespace
+
+OwnershipStore::OwnershipStore()
+    : m_header(nullptr)
+    , m_slots(nullptr)
+    , m_size(0)
+{
+}
+
+OwnershipStore::~OwnershipStore()
+{
+    if (m_header)
+        ::munmap(m_header, m_size);
+}
+
+bool OwnershipStore::open(const QString& path, quint32 capacity)
+{
+    if (m_header || !capacity)
+        return false;
+
+    const std::size_t size = sizeof(Header) + std::size_t(capacity) * sizeof(Slot);
+
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot open ownership store" << path;
+        return false;
+    }
+
+    struct stat info;
+    const bool resize = ::fstat(fd, &info) != 0 || std::size_t(info.st_size) != size;
+    if (resize && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, off_t(size)) != 0)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot size ownership store" << path;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot map ownership store" << path;
+        return false;
+    }
+
+    m_header = static_cast<Header*>(mapping);
+    m_slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+    m_size = size;
+
+    const bool valid = std::memcmp(m_header->magic, Magic, sizeof(Magic)) == 0
+        && m_header->version == Version
+        && m_header->slotSize == sizeof(Slot)
+        && m_header->capacity == capacity;
+    if (!valid) {
+        std::memset(mapping, 0, size);
+        std::memcpy(m_header->magic, Magic, sizeof(Magic));
+        m_header->version = Version;
+        m_header->slotSize = sizeof(Slot);
+        m_header->capacity = capacity;
+    }
+
+    // half-written slots of a crash are dropped
+    for (quint32 i = capacity; i-- > 0;) {
+        Slot& slot = m_slots[i];
+        if (slot.state.load(std::memory_order_acquire) == Used && !m_index.contains(slot.id)) {
+            m_index.insert(slot.id, i);
+        } else {
+            slot.state.store(Free, std::memory_order_relaxed);
+            m_free.append(i);
+        }
+    }
+
+    return true;
+}
+
+QList<OwnershipStore::Entry> OwnershipStore::entries() const
+{
+    QList<Entry> entries;
+    entries.reserve(m_index.size());
+
+    for (quint32 index : m_index) {
+        const Slot& slot = m_slots[index];
+
+        Entry entry;
+        entry.id = slot.id;
+        entry.priority = slot.priority;
+        entry.type = slot.type;
+        entry.mandatory = slot.mandatory;
+        entry.optional = slot.optional;
+        entry.share = slot.share;
+        entry.mask = slot.mask;
+        entry.granted = slot.granted.load(std::memory_order_relaxed);
+        entry.service = QString::fromUtf8(slot.service, std::min<int>(slot.serviceLength, sizeof(slot.service)));
+        entry.klass = QString::fromUtf8(slot.klass, std::min<int>(slot.classLength, sizeof(slot.klass)));
+        entry.mode = QString::fromUtf8(slot.mode, std::min<int>(slot.modeLength, sizeof(slot.mode)));
+        entries.append(entry);
+    }
+
+    // registration order
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+    return entries;
+}
+
+void OwnershipStore::store(const Entry& entry)
+{
+    if (!m_header)
+        return;
+
+    auto it = m_index.constFind(entry.id);
+    quint32 index;
+    if (it != m_index.constEnd()) {
+        index = *it;
+    } else if (!m_free.isEmpty()) {
+        index = m_free.takeLast();
+        m_index.insert(entry.id, index);
+    } else {
+        qCWarning(lcResourceDaemonCoreLog) << "Ownership store full, client" << entry.id << "will not survive a restart";
+        return;
+    }
+
+    Slot& slot = m_slots[index];
+    slot.state.store(Writing, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.id = entry.id;
+    slot.priority = entry.priority;
+    slot.type = entry.type;
+    slot.mandatory = entry.mandatory;
+    slot.optional = entry.optional;
+    slot.share = entry.share;
+    slot.mask = entry.mask;
+    slot.granted.store(entry.granted, std::memory_order_relaxed);
+    std::memset(slot.service, 0, sizeof(slot.service));
+    std::memset(slot.klass, 0, sizeof(slot.klass));
+    std::memset(slot.mode, 0, sizeof(slot.mode));
+    slot.serviceLength = copyString(slot.service, entry.service);
+    slot.classLength = copyString(slot.klass, entry.klass);
+    slot.modeLength = copyString(slot.mode, entry.mode);
+
+    slot.state.store(Used, std::memory_order_release);
+}
+
+void OwnershipStore::remove(uint id)
+{
+    if (!m_header)
+        return;
+
+    const auto it = m_index.constFind(id);
+    if (it == m_index.constEnd())
+        return;
+
+    m_slots[*it].state.store(Free, std::memory_order_release);
+    m_free.append(*it);
+    m_index.erase(it);
+}
+
+/* private */
+
+void OwnershipStore::updateGranted(uint id, ResourcePolicy::ResourceMask granted)
+{
+    const auto it = m_index.constFind(id);
+    if (it != m_index.constEnd())
+        m_slots[*it].granted.store(granted, std::memory_order_release);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OWNERSHIPSTORE_H
+#define OWNERSHIPSTORE_H
+
+#include "core/resourcetypes.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <atomic>
+
+/**
+ * Resource sets and what they hold, kept in a memory-mapped file so a
+ * restarted daemon can pick up where the previous one crashed.
+ *
+ * One fixed-size slot per client: registration writes the whole slot,
+ * ownership changes only store the granted mask. A slot is published
+ * with a release store of its state, torn slots are skipped on load.
+ */
+class OwnershipStore {
+public:
+    struct Entry {
+        uint id = 0;
+        int priority = 0;
+        int type = 0;
+        ResourcePolicy::ResourceMask mandatory = 0;
+        ResourcePolicy::ResourceMask optional = 0;
+        ResourcePolicy::ResourceMask share = 0;
+        ResourcePolicy::ResourceMask mask = 0;
+        ResourcePolicy::ResourceMask granted = 0;
+        QString service;
+        QString klass;
+        QString mode;
+    };
+
+    OwnershipStore();
+    ~OwnershipStore();
+
+    /**
+     * Map @path with room for @capacity clients. Entries of a previous
+     * run with the same layout are kept for entries().
+     */
+    bool open(const QString& path, quint32 capacity);
+    bool isOpen() const { return m_header; }
+
+    QList<Entry> entries() const;
+    quint32 lastClientId() const { return m_header ? m_header->lastClientId.load(std::memory_order_relaxed) : 0; }
+    void setLastClientId(quint32 id)
+    {
+        if (m_header)
+            m_header->lastClientId.store(id, std::memory_order_relaxed);
+    }
+
+    void store(const Entry& entry);
+    void setGranted(uint id, ResourcePolicy::ResourceMask granted)
+    {
+        if (m_header)
+            updateGranted(id, granted);
+    }
+    void remove(uint id);
+
+private:
+    enum SlotState : quint32 {
+        Free,
+        Writing,
+        Used
+    };
+
+    // file layout, version 1
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 slotSize;
+        quint32 capacity;
+        std::atomic<quint32> lastClientId;
+    };
+
+    struct Slot {
+        std::atomic<quint32> state;
+        quint32 id;
+        qint32 priority;
+        qint32 type;
+        quint32 mandatory;
+        quint32 optional;
+        quint32 share;
+        quint32 mask;
+        std::atomic<quint32> granted;
+        quint8 serviceLength;
+        quint8 classLength;
+        quint8 modeLength;
+        quint8 reserved;
+        char service[48];
+        char klass[24];
+        char mode[16];
+    };
+    static_assert(sizeof(Slot) == 128);
+
+    void updateGranted(uint id, ResourcePolicy::ResourceMask granted);
+
+    Header* m_header;
+    Slot* m_slots;
+    std::size_t m_size;
+
+    // client id → slot, and the free slots
+    QHash<uint, quint32> m_index;
+    QList<quint32> m_free;
+};
+
+#endif // OWNERSHIPSTORE_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+/**
+ * Bounded wait-free queue for exactly one producer and one consumer thread.
+ * Head and tail live on their own cache lines, each side keeps a cached
+ * copy of the other's index and only reloads it when the queue looks
+ * full (producer) or empty (consumer).
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer side, false if full
+    bool push(T&& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity)
+                return false;
+        }
+
+        m_slots[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    std::optional<T> pop()
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+                return std::nullopt;
+        }
+
+        std::optional<T> value(std::move(m_slots[head & (Capacity - 1)]));
+        m_slots[head & (Capacity - 1)] = T();
+        m_head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    alignas(64) std::atomic<std::size_t> m_head { 0 };
+    std::size_t m_cachedTail = 0; // consumer only
+
+    alignas(64) std::atomic<std::size_t> m_tail { 0 };
+    std::size_t m_cachedHead = 0; // producer only
+
+    alignas(64) std::array<T, Capacity> m_slots {};
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "statistics.h"
+
+const char* Statistics::methodName(Method method)
+{
+    static const char* const names[MethodCount] = {
+        "register",
+        "acquire",
+        "release",
+        "unregister",
+    };
+    return names[method];
+}
+
+const char* Statistics::counterName(Counter counter)
+{
+    static const char* const names[CounterCount] = {
+        "grants",
+        "preemptions",
+        "denials",
+        "handoffs",
+        "shared_grants",
+        "duplicate_requests",
+        "suppressed_flips",
+    };
+    return names[counter];
+}
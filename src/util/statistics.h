@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include <array>
+#include <bit>
+
+/**
+ * Power-of-two latency histogram.
+ * Bucket i counts samples below 2^i ns (and not below 2^(i-1) ns).
+ */
+class LatencyHistogram {
+public:
+    static constexpr int Buckets = 32;
+
+    void record(qint64 nsecs)
+    {
+        const int bucket = std::bit_width(quint64(qMax<qint64>(nsecs, 0)));
+        ++m_buckets[qMin(bucket, Buckets - 1)];
+        ++m_count;
+        m_total += nsecs;
+    }
+
+    quint64 count() const { return m_count; }
+    quint64 total() const { return m_total; }
+    const std::array<quint64, Buckets>& buckets() const { return m_buckets; }
+
+private:
+    std::array<quint64, Buckets> m_buckets {};
+    quint64 m_count = 0;
+    quint64 m_total = 0;
+};
+
+/**
+ * Always-on daemon counters, exported by the Stats D-Bus interface.
+ * Recording is a couple of integer increments, no locking.
+ */
+class Statistics {
+public:
+    enum Method {
+        Register,
+        Acquire,
+        Release,
+        Unregister,
+        MethodCount
+    };
+
+    enum Counter {
+        Grants,
+        Preemptions,
+        Denials,
+        Handoffs,
+        SharedGrants,
+        Duplicates,
+        SuppressedFlips,
+        CounterCount
+    };
+
+    /** Records the lifetime of the scope as one @method call. */
+    class Timer {
+    public:
+        Timer(Statistics& statistics, Method method)
+            : m_statistics(statistics)
+            , m_method(method)
+        {
+            m_timer.start();
+        }
+        ~Timer() { m_statistics.record(m_method, m_timer.nsecsElapsed()); }
+
+    private:
+        Statistics& m_statistics;
+        Method m_method;
+        QElapsedTimer m_timer;
+    };
+
+    void record(Method method, qint64 nsecs) { m_latency[method].record(nsecs); }
+    void increment(Counter counter, quint64 amount = 1) { m_counters[counter] += amount; }
+
+    const LatencyHistogram& latency(Method method) const { return m_latency[method]; }
+    quint64 counter(Counter counter) const { return m_counters[counter]; }
+
+    static const char* methodName(Method method);
+    static const char* counterName(Counter counter);
+
+private:
+    std::array<LatencyHistogram, MethodCount> m_latency;
+    std::array<quint64, CounterCount> m_counters {};
+};
+
+#endif // STATISTICS_H
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "traffictrace.h"
+#include "logger.h"
+
+#include <QMutexLocker>
+
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+std::atomic<TrafficTrace*> installed { nullptr };
+
+constexpr QDataStream::Version StreamVersion = QDataStream::Qt_6_2;
+
+} // namespace
+
+TrafficTrace::TrafficTrace()
+{
+}
+
+TrafficTrace::~TrafficTrace()
+{
+    TrafficTrace* self = this;
+    installed.compare_exchange_strong(self, nullptr);
+
+    if (m_file.isOpen())
+        m_file.flush();
+}
+
+bool TrafficTrace::open(const QString& path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcResourceDaemonCoreLog) << "Cannot write traffic trace" << path << m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(StreamVersion);
+    m_stream.writeRawData(Magic, sizeof(Magic));
+    m_stream << Version;
+
+    m_clock.start();
+    return true;
+}
+
+void TrafficTrace::install()
+{
+    if (isOpen())
+        installed.store(this, std::memory_order_release);
+}
+
+TrafficTrace* TrafficTrace::instance()
+{
+    return installed.load(std::memory_order_acquire);
+}
+
+void TrafficTrace::recordCall(Kind kind, const QString& peer, const QVariantList& args, const QString& member)
+{
+    QMutexLocker locker(&m_lock);
+
+    const quint32 index = peerIndex(peer);
+    begin(kind);
+    m_stream << index;
+
+    switch (kind) {
+    case Register:
+        // type, id, reqno, mandatory, optional, share, mask, klass, mode, priority
+        m_stream << qint32(args.value(0).toInt());
+        for (int i = 1; i < 7; ++i)
+            m_stream << quint32(args.value(i).toUInt());
+        m_stream << args.value(7).toString() << args.value(8).toString() << quint32(args.value(9).toUInt());
+        break;
+    case ClientCall:
+        m_stream << member;
+        m_stream << qint32(args.value(0).toInt()) << quint32(args.value(1).toUInt())
+                 << quint32(args.value(2).toUInt()) << quint32(args.value(3).toUInt());
+        break;
+    default:
+        // type, id, reqno
+        m_stream << qint32(args.value(0).toInt()) << quint32(args.value(1).toUInt()) << quint32(args.value(2).toUInt());
+        break;
+    }
+}
+
+void TrafficTrace::recordRegistered(uint id)
+{
+    QMutexLocker locker(&m_lock);
+
+    begin(Registered);
+    m_stream << quint32(id);
+}
+
+void TrafficTrace::recordReap(const QString& peer)
+{
+    QMutexLocker locker(&m_lock);
+
+    const quint32 index = peerIndex(peer);
+    begin(Reap);
+    m_stream << index;
+}
+
+void TrafficTrace::recordNotify(uint id, quint8 event, ResourcePolicy::ResourceMask resources)
+{
+    QMutexLocker locker(&m_lock);
+
+    begin(Notify);
+    m_stream << quint32(id) << event << quint32(resources);
+}
+
+/* private, m_lock held */
+
+void TrafficTrace::begin(Kind kind)
+{
+    m_stream << quint8(kind) << quint64(m_clock.nsecsElapsed());
+}
+
+quint32 TrafficTrace::peerIndex(const QString& peer)
+{
+    auto it = m_peers.constFind(peer);
+    if (it != m_peers.constEnd())
+        return *it;
+
+    const quint32 index = quint32(m_peers.size());
+    m_peers.insert(peer, index);
+
+    begin(Peer);
+    m_stream << index << peer;
+    return index;
+}
+
+/* reader */
+
+bool TrafficTrace::Reader::open(const QString& path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(StreamVersion);
+
+    char magic[sizeof(Magic)];
+    quint32 version = 0;
+    if (m_stream.readRawData(magic, sizeof(magic)) != int(sizeof(magic))
+        || std::memcmp(magic, Magic, sizeof(Magic)) != 0
+        || (m_stream >> version, version != Version)) {
+        m_error = QStringLiteral("not a version %1 traffic trace").arg(Version);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Decode the next record into @entry, Peer records are consumed here.
+ * Returns false at the end of the trace or on a truncated record.
+ */
+bool TrafficTrace::Reader::next(Entry& entry)
+{
+    while (!m_stream.atEnd()) {
+        entry = Entry();
+
+        quint8 kind = KindCount;
+        m_stream >> kind >> entry.nsecs;
+        entry.kind = Kind(kind);
+
+        quint32 peer = 0;
+        switch (entry.kind) {
+        case Peer: {
+            QString name;
+            m_stream >> peer >> name;
+            if (peer == quint32(m_peers.size()))
+                m_peers.append(name);
+            break;
+        }
+        case Register:
+            m_stream >> peer >> entry.type >> entry.id >> entry.reqno
+                >> entry.mandatory >> entry.optional >> entry.share >> entry.mask
+                >> entry.klass >> entry.mode >> entry.priority;
+            break;
+        case Registered:
+            m_stream >> entry.id;
+            break;
+        case Acquire:
+        case Release:
+        case Unregister:
+            m_stream >> peer >> entry.type >> entry.id >> entry.reqno;
+            break;
+        case Reap:
+            m_stream >> peer;
+            break;
+        case ClientCall:
+            m_stream >> peer >> entry.member >> entry.type >> entry.id >> entry.reqno >> entry.resources;
+            break;
+        case Notify:
+            m_stream >> entry.id >> entry.event >> entry.resources;
+            break;
+        case KindCount:
+        default:
+            m_error = QStringLiteral("unknown record kind %1").arg(kind);
+            return false;
+        }
+
+        if (m_stream.status() != QDataStream::Ok) {
+            m_error = QStringLiteral("truncated record");
+            return false;
+        }
+
+        if (entry.kind == Peer)
+            continue;
+
+        entry.peer = m_peers.value(peer);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TRAFFICTRACE_H
+#define TRAFFICTRACE_H
+
+#include "core/resourcetypes.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+
+/**
+ * Binary trace of the calls resourced served and the notifications they
+ * caused, written in record mode (--record) and fed back into the core by
+ * resourced-replay.
+ *
+ * Manager calls are written by the arbitration thread right before they
+ * are handled, so the trace has them in the order they were decided.
+ * Peer names are written once and referenced by index afterwards.
+ */
+class TrafficTrace {
+public:
+    enum Kind : quint8 {
+        Peer, // first use of a bus name or peer connection
+        Register,
+        Registered, // id the preceding Register got
+        Acquire,
+        Release,
+        Unregister,
+        Reap, // peer left the bus, all of its sets are gone
+        ClientCall, // org.maemo.resource.client
+        Notify, // ResourceManager::clientNotified()
+        KindCount
+    };
+
+    static constexpr char Magic[8] = { 'R', 'D', 'T', 'R', 'A', 'C', 'E', '\0' };
+    static constexpr quint32 Version = 1;
+
+    // one decoded record, fields not used by a kind are left at zero
+    struct Entry {
+        Kind kind = KindCount;
+        quint64 nsecs = 0; // since recording started
+        QString peer;
+        QString member; // ClientCall
+        qint32 type = 0;
+        quint32 id = 0;
+        quint32 reqno = 0;
+        ResourcePolicy::ResourceMask mandatory = 0; // Register
+        ResourcePolicy::ResourceMask optional = 0;
+        ResourcePolicy::ResourceMask share = 0;
+        ResourcePolicy::ResourceMask mask = 0;
+        QString klass;
+        QString mode;
+        quint32 priority = 0;
+        ResourcePolicy::ResourceMask resources = 0; // Notify, ClientCall
+        quint8 event = 0; // Notify, a ResourceClient::Event
+    };
+
+    TrafficTrace();
+    ~TrafficTrace();
+
+    // recording, safe to call from any thread
+    bool open(const QString& path);
+    bool isOpen() const { return m_file.isOpen(); }
+
+    /**
+     * Make this the trace the adaptors write to.
+     */
+    void install();
+    static TrafficTrace* instance();
+
+    /**
+     * @args as demarshalled for @kind: Register, Acquire, Release,
+     * Unregister or ClientCall with @member.
+     */
+    void recordCall(Kind kind, const QString& peer, const QVariantList& args, const QString& member = QString());
+    void recordRegistered(uint id);
+    void recordReap(const QString& peer);
+    void recordNotify(uint id, quint8 event, ResourcePolicy::ResourceMask resources);
+
+    /**
+     * Sequential reader for resourced-replay.
+     */
+    class Reader {
+    public:
+        bool open(const QString& path);
+        bool next(Entry& entry);
+        QString errorString() const { return m_error; }
+
+    private:
+        QFile m_file;
+        QDataStream m_stream;
+        QStringList m_peers;
+        QString m_error;
+    };
+
+private:
+    void begin(Kind kind);
+    quint32 peerIndex(const QString& peer);
+
+    QMutex m_lock;
+    QFile m_file;
+    QDataStream m_stream;
+    QHash<QString, quint32> m_peers;
+    QElapsedTimer m_clock;
+};
+
+#endif // TRAFFICTRACE_H
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * In-process microbenchmarks for the arbitration core, no D-Bus involved.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "core/resourcetypes.h"
+#include "policy/arbitrationpolicy.h"
+#include "policy/prioritypolicy.h"
+#include "util/config.h"
+
+#include <QDBusMessage>
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+#include <QtTest>
+
+#include <malloc.h>
+
+#include <bit>
+#include <vector>
+
+namespace {
+
+// all resources libresource has a bit for
+const ResourcePolicy::ResourceMask LibresourceMask = 0x7f7f;
+
+QDBusMessage registerMessage(int peer)
+{
+    return QDBusMessage::createMethodCall(QStringLiteral(":1.%1").arg(peer),
+        QStringLiteral("/org/maemo/resource/manager"),
+        QStringLiteral("org.maemo.resource.manager"),
+        QStringLiteral("register"));
+}
+
+ResourcePolicy::ResourceMask randomSet(QRandomGenerator& random, int size)
+{
+    ResourcePolicy::ResourceMask set = 0;
+    while (std::popcount(set) < size)
+        set |= ResourcePolicy::maskOf(random.bounded(ResourcePolicy::MaxResources)) & LibresourceMask;
+    return set;
+}
+
+/**
+ * @preemptors is the share of clients with a high priority: their
+ * requests preempt the low priority ones, everybody else gets denied.
+ */
+std::vector<ResourceClient*> createClients(ResourceManager& manager, int count,
+    int setSize, double preemptors)
+{
+    QRandomGenerator random(42);
+    std::vector<ResourceClient*> clients;
+    clients.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        const int priority = random.generateDouble() < preemptors ? 10 + random.bounded(10) : 0;
+        ResourceClient* client = manager.createClient(registerMessage(i), priority);
+        client->setResourceSet(randomSet(random, setSize), 0, 0, 0);
+        clients.push_back(client);
+    }
+    return clients;
+}
+
+// heap in use, glibc only
+size_t heapInUse()
+{
+    return mallinfo2().uordblks;
+}
+
+// a resource set as it was kept before ClientPool: one QObject per set and
+// one more exporting it, registered by id, object path and bus name
+class LegacyClient : public QObject {
+public:
+    using QObject::QObject;
+
+    int priority = 0;
+    ResourcePolicy::ResourceMask mandatory = 0;
+    ResourcePolicy::ResourceMask optional = 0;
+    ResourcePolicy::ResourceMask share = 0;
+    ResourcePolicy::ResourceMask mask = 0;
+    ResourcePolicy::ResourceMask granted = 0;
+    QString klass;
+    QString mode;
+    quint8 classId = 0;
+    QString objectPath;
+    int type = 0;
+    uint id = 0;
+    uint reqno = 0;
+    QString service;
+};
+
+struct LegacyRegistry {
+    QObject owner;
+    QHash<uint, LegacyClient*> byId;
+    QHash<QString, LegacyClient*> byPath;
+    QHash<QString, QList<LegacyClient*>> byService;
+
+    void create(int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            LegacyClient* client = new LegacyClient(&owner);
+            client->id = i + 1;
+            client->objectPath = QStringLiteral("/org/maemo/resource/client%1").arg(client->id);
+            client->service = QStringLiteral(":1.%1").arg(i);
+            client->mandatory = ResourcePolicy::Bit::AudioPlayback;
+
+            // the adaptor and the notify() connection to the batcher
+            QObject* adaptor = new QObject(client);
+            QObject::connect(client, &QObject::objectNameChanged, adaptor, []() { });
+
+            byId.insert(client->id, client);
+            byPath.insert(client->objectPath, client);
+            byService[client->service].append(client);
+        }
+    }
+};
+
+// decisions of @Policy over all pairs of @clients
+template <typename Policy>
+void benchPolicy(const PolicySnapshot& settings, const std::vector<ResourceClient*>& clients)
+{
+    size_t next = 0;
+    bool decision = false;
+    QBENCHMARK {
+        const ResourceClient& newClient = *clients[next];
+        const ResourceClient& owner = *clients[(next + 1) % clients.size()];
+        next = (next + 1) % clients.size();
+        decision ^= Policy::canPreempt(settings, newClient, owner, ResourcePolicy::Bit::AudioPlayback);
+    }
+    Q_UNUSED(decision);
+}
+
+} // namespace
+
+class BenchArbitration : public QObject {
+    Q_OBJECT
+
+private slots:
+    void clientLookup_data();
+    void clientLookup();
+
+    void acquire_data();
+    void acquire();
+
+    void requestResources_data();
+    void requestResources();
+
+    void grantRelease_data();
+    void grantRelease();
+
+    void isOwner_data();
+    void isOwner();
+
+    void canPreempt_data();
+    void canPreempt();
+
+    void policyDispatch_data();
+    void policyDispatch();
+
+    void clientFootprint_data();
+    void clientFootprint();
+};
+
+void BenchArbitration::clientLookup_data()
+{
+    QTest::addColumn<int>("clients");
+
+    for (int clients : { 10, 100, 1000, 10000 })
+        QTest::addRow("%d clients", clients) << clients;
+}
+
+/* the lookup acquire/release/unregister do, must stay flat with the client count */
+void BenchArbitration::clientLookup()
+{
+    QFETCH(int, clients);
+
+    ResourceManager manager;
+    const auto all = createClients(manager, clients, 1, 0);
+
+    uint id = 0;
+    QBENCHMARK {
+        id = id % clients + 1;
+        ResourceClient* client = manager.clientById(id);
+        QVERIFY(client);
+    }
+}
+
+void BenchArbitration::acquire_data()
+{
+    QTest::addColumn<int>("clients");
+
+    for (int clients : { 10, 100, 1000, 10000 })
+        QTest::addRow("%d clients", clients) << clients;
+}
+
+/* what an acquire() costs in the core: lookup by id, arbitration against
+   the current owners, release; must stay flat with the client count */
+void BenchArbitration::acquire()
+{
+    QFETCH(int, clients);
+
+    ResourceManager manager;
+    const auto all = createClients(manager, clients, 2, 0.1);
+    for (ResourceClient* client : all)
+        manager.requestResources(client, client->mandatory());
+
+    uint id = 0;
+    QBENCHMARK {
+        id = id % clients + 1;
+        ResourceClient* client = manager.clientById(id);
+        manager.releaseAll(client);
+        manager.requestResources(client, client->mandatory() | client->optional());
+    }
+}
+
+void BenchArbitration::requestResources_data()
+{
+    QTest::addColumn<int>("clients");
+    QTest::addColumn<int>("setSize");
+    QTest::addColumn<double>("preemptors");
+
+    for (int clients : { 10, 100, 1000, 10000 }) {
+        for (int setSize : { 1, 4, 8 }) {
+            for (double preemptors : { 0.0, 0.1, 0.5 })
+                QTest::addRow("%d clients, %d resources, %.1f preemptors", clients, setSize, preemptors)
+                    << clients << setSize << preemptors;
+        }
+    }
+}
+
+/* round robin over all clients: each one drops its set and asks for it again */
+void BenchArbitration::requestResources()
+{
+    QFETCH(int, clients);
+    QFETCH(int, setSize);
+    QFETCH(double, preemptors);
+
+    ResourceManager manager;
+    const auto all = createClients(manager, clients, setSize, preemptors);
+
+    size_t next = 0;
+    QBENCHMARK {
+        ResourceClient* client = all[next];
+        next = (next + 1) % all.size();
+
+        manager.releaseAll(client);
+        manager.requestResources(client, client->mandatory());
+    }
+}
+
+void BenchArbitration::grantRelease_data()
+{
+    QTest::addColumn<int>("setSize");
+
+    for (int setSize : { 1, 4, 8, 14 })
+        QTest::addRow("%d resources", setSize) << setSize;
+}
+
+/* uncontended acquire followed by releaseAll */
+void BenchArbitration::grantRelease()
+{
+    QFETCH(int, setSize);
+
+    ResourceManager manager;
+    ResourceClient* client = createClients(manager, 1, setSize, 0).front();
+
+    QBENCHMARK {
+        manager.requestResources(client, client->mandatory());
+        manager.releaseAll(client);
+    }
+}
+
+void BenchArbitration::isOwner_data()
+{
+    QTest::addColumn<int>("clients");
+
+    for (int clients : { 10, 1000 })
+        QTest::addRow("%d clients", clients) << clients;
+}
+
+void BenchArbitration::isOwner()
+{
+    QFETCH(int, clients);
+
+    ResourceManager manager;
+    const auto all = createClients(manager, clients, 2, 0);
+    for (ResourceClient* client : all)
+        manager.requestResources(client, client->mandatory());
+
+    size_t next = 0;
+    bool owner = false;
+    QBENCHMARK {
+        ResourceClient* client = all[next];
+        next = (next + 1) % all.size();
+        owner ^= manager.isOwner(ResourcePolicy::Bit::AudioPlayback, client);
+    }
+    Q_UNUSED(owner);
+}
+
+void BenchArbitration::canPreempt_data()
+{
+    QTest::addColumn<int>("classes");
+
+    // 0: priorities only; otherwise every class pair has a rule
+    for (int classes : { 0, 4, 16, 64 })
+        QTest::addRow("%d classes", classes) << classes;
+}
+
+/* one table lookup, must stay flat with the number of rules */
+void BenchArbitration::canPreempt()
+{
+    QFETCH(int, classes);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write("[PreemptionRules]\n");
+    for (int requester = 0; requester < classes; ++requester) {
+        for (int owner = 0; owner < classes; ++owner)
+            file.write(QStringLiteral("c%1>c%2=AudioPlayback\n").arg(requester).arg(owner).toLatin1());
+    }
+    file.close();
+
+    ResourceManager manager;
+    QVERIFY(manager.config()->load(file.fileName()));
+    const auto all = createClients(manager, 2, 1, 0.5);
+    if (classes) {
+        manager.setClientClass(all[0], QStringLiteral("c%1").arg(classes - 1), QString());
+        manager.setClientClass(all[1], QStringLiteral("c0"), QString());
+    }
+    PriorityPolicy policy(manager.config());
+
+    bool decision = false;
+    QBENCHMARK {
+        decision ^= policy.canPreempt(all[0], all[1], ResourcePolicy::Bit::AudioPlayback);
+    }
+    Q_UNUSED(decision);
+}
+
+void BenchArbitration::policyDispatch_data()
+{
+    QTest::addColumn<QString>("policy");
+    QTest::addColumn<bool>("specialized");
+
+    for (const char* policy : { "class-table", "strict-priority", "fifo" }) {
+        QTest::addRow("%s, specialized", policy) << QString::fromLatin1(policy) << true;
+        QTest::addRow("%s, runtime", policy) << QString::fromLatin1(policy) << false;
+    }
+}
+
+/* the strategy a daemon is built with against the one picked per call */
+void BenchArbitration::policyDispatch()
+{
+    QFETCH(QString, policy);
+    QFETCH(bool, specialized);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(QStringLiteral("[Preemption]\nPolicy=%1\n[PreemptionRules]\n").arg(policy).toLatin1());
+    for (int requester = 0; requester < 16; ++requester) {
+        for (int owner = 0; owner < 16; owner += 2)
+            file.write(QStringLiteral("c%1>c%2=AudioPlayback\n").arg(requester).arg(owner).toLatin1());
+    }
+    file.close();
+
+    ResourceManager manager;
+    QVERIFY(manager.config()->load(file.fileName()));
+    const auto all = createClients(manager, 64, 1, 0.5);
+    for (size_t i = 0; i < all.size(); ++i)
+        manager.setClientClass(all[i], QStringLiteral("c%1").arg(i % 16), QString());
+
+    const PolicySnapshot& settings = *manager.config()->snapshot();
+    if (!specialized)
+        benchPolicy<ArbitrationPolicy::Runtime>(settings, all);
+    else if (settings.policy == PolicyKind::StrictPriority)
+        benchPolicy<ArbitrationPolicy::StrictPriority>(settings, all);
+    else if (settings.policy == PolicyKind::Fifo)
+        benchPolicy<ArbitrationPolicy::Fifo>(settings, all);
+    else
+        benchPolicy<ArbitrationPolicy::ClassTable>(settings, all);
+}
+
+void BenchArbitration::clientFootprint_data()
+{
+    QTest::addColumn<bool>("legacy");
+    QTest::addColumn<int>("clients");
+
+    for (int clients : { 100, 1000, 10000 }) {
+        QTest::addRow("QObject, %d clients", clients) << true << clients;
+        QTest::addRow("pooled, %d clients", clients) << false << clients;
+    }
+}
+
+/* heap bytes per registered resource set, reported instead of a time */
+void BenchArbitration::clientFootprint()
+{
+    QFETCH(bool, legacy);
+    QFETCH(int, clients);
+
+    ResourceManager manager;
+    LegacyRegistry registry;
+
+    const size_t before = heapInUse();
+    if (legacy) {
+        registry.create(clients);
+    } else {
+        for (int i = 0; i < clients; ++i) {
+            ResourceClient* client = manager.createClient(registerMessage(i), 0);
+            client->setResourceSet(ResourcePolicy::Bit::AudioPlayback, 0, 0, 0);
+        }
+    }
+    const size_t after = heapInUse();
+
+    QTest::setBenchmarkResult(qreal(after - before) / clients, QTest::BytesAllocated);
+}
+
+QTEST_GUILESS_MAIN(BenchArbitration)
+#include "bench_arbitration.moc"
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Per-message cost of the manager adaptor's dispatch, no bus involved:
+ * replies go to a connection that is not connected and are dropped.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "dbus/manageradaptor.h"
+#include "util/statistics.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QtTest>
+
+namespace {
+
+QDBusMessage managerCall(const QString& interface, const QString& member)
+{
+    return QDBusMessage::createMethodCall(QStringLiteral(":1.1"),
+        QStringLiteral("/org/maemo/resource/manager"),
+        interface,
+        member);
+}
+
+} // namespace
+
+class BenchDispatch : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void legacyLookup();
+    void tableLookup();
+    void acquire();
+    void cachedRetry();
+    void getCounters();
+
+private:
+    QDBusConnection m_connection { QStringLiteral("bench-disconnected") };
+};
+
+void BenchDispatch::initTestCase()
+{
+    QVERIFY(!m_connection.isConnected());
+}
+
+/* what handleMessage used to do before reaching a handler */
+void BenchDispatch::legacyLookup()
+{
+    QDBusMessage message = managerCall(QStringLiteral("org.maemo.resource.manager"), QStringLiteral("release"));
+    message << 4 << uint(1) << uint(1);
+
+    int matched = 0;
+    QBENCHMARK {
+        QString member = message.member();
+        QString interface = message.interface();
+        if (message.interface() == "org.freedesktop.DBus.Introspectable")
+            continue;
+        if (message.type() != QDBusMessage::MethodCallMessage)
+            continue;
+        if (message.interface() != "org.maemo.resource.manager")
+            continue;
+        if (message.arguments().count() >= 3) {
+            matched += message.arguments()[0].toInt() + message.arguments()[1].toUInt() + message.arguments()[2].toUInt();
+        }
+        if (message.member() == "register" || message.member() == "unregister"
+            || message.member() == "acquire" || message.member() == "release")
+            ++matched;
+    }
+    QVERIFY(matched > 0);
+}
+
+/* unknown member: a full walk of the dispatch table */
+void BenchDispatch::tableLookup()
+{
+    ResourceManager manager;
+    ManagerAdaptor adaptor(&manager);
+
+    QDBusMessage message = managerCall(QStringLiteral("org.maemo.resource.manager"), QStringLiteral("update"));
+    message << 2 << uint(1) << uint(1);
+
+    bool handled = false;
+    QBENCHMARK {
+        handled |= adaptor.handleMessage(message, m_connection);
+    }
+    QVERIFY(!handled);
+}
+
+/* dispatch plus arbitration plus building the reply, a new request every time */
+void BenchDispatch::acquire()
+{
+    ResourceManager manager;
+    ManagerAdaptor adaptor(&manager);
+
+    ResourceClient* client = manager.createClient(managerCall(QString(), QString()), 0);
+    client->setResourceSet(ResourcePolicy::Bit::AudioPlayback, 0, 0, 0);
+
+    QDBusMessage message = managerCall(QStringLiteral("org.maemo.resource.manager"), QStringLiteral("acquire"));
+
+    uint reqno = 0;
+    QBENCHMARK {
+        message.setArguments({ 3, client->clientID(), ++reqno });
+        QVERIFY(adaptor.handleMessage(message, m_connection));
+    }
+    QCOMPARE(manager.stats().counter(Statistics::Duplicates), quint64(0));
+}
+
+/* libresource retrying a request already answered: only the cached status goes out */
+void BenchDispatch::cachedRetry()
+{
+    ResourceManager manager;
+    ManagerAdaptor adaptor(&manager);
+
+    ResourceClient* client = manager.createClient(managerCall(QString(), QString()), 0);
+    client->setResourceSet(ResourcePolicy::Bit::AudioPlayback, 0, 0, 0);
+
+    QDBusMessage message = managerCall(QStringLiteral("org.maemo.resource.manager"), QStringLiteral("acquire"));
+    message << 3 << client->clientID() << uint(1);
+    QVERIFY(adaptor.handleMessage(message, m_connection));
+
+    QBENCHMARK {
+        QVERIFY(adaptor.handleMessage(message, m_connection));
+    }
+    QVERIFY(manager.stats().counter(Statistics::Duplicates) > 0);
+}
+
+void BenchDispatch::getCounters()
+{
+    ResourceManager manager;
+    ManagerAdaptor adaptor(&manager);
+
+    const QDBusMessage message = managerCall(QStringLiteral("org.maemo.resource.manager.Stats"), QStringLiteral("GetCounters"));
+
+    QBENCHMARK {
+        QVERIFY(adaptor.handleMessage(message, m_connection));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchDispatch)
+#include "bench_dispatch.moc"
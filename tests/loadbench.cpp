@@ -0,0 +1,534 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * End-to-end load benchmark.
+ *
+ * Starts a private dbus-daemon, runs resourced on it (as its "system" bus)
+ * and drives it with simulated libresource clients doing
+ * register / acquire / release / unregister cycles. Prints per-method
+ * throughput and latency percentiles as JSON.
+ */
+
+#include "core/resourcetypes.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <algorithm>
+#include <csignal>
+#include <sched.h>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const QString ManagerService = QStringLiteral("org.maemo.resource.manager");
+const QString ManagerPath = QStringLiteral("/org/maemo/resource/manager");
+const QString ManagerInterface = QStringLiteral("org.maemo.resource.manager");
+
+// every client that does not fight for the hot resource picks one of these
+constexpr ResourcePolicy::ResourceMask ColdResources[] = {
+    ResourcePolicy::Bit::VideoPlayback,
+    ResourcePolicy::Bit::AudioRecording,
+    ResourcePolicy::Bit::VideoRecording,
+    ResourcePolicy::Bit::Vibra,
+    ResourcePolicy::Bit::Leds,
+    ResourcePolicy::Bit::Backlight,
+    ResourcePolicy::Bit::SystemButton,
+    ResourcePolicy::Bit::LockButton,
+    ResourcePolicy::Bit::ScaleButton,
+    ResourcePolicy::Bit::SnapButton,
+    ResourcePolicy::Bit::LensCover,
+    ResourcePolicy::Bit::HeadsetButtons,
+    ResourcePolicy::Bit::LargeScreen,
+};
+
+enum Method {
+    Register,
+    Acquire,
+    Release,
+    Unregister,
+    MethodCount
+};
+
+// libresource message types
+const int MethodTypes[MethodCount] = { 0, 3, 4, 1 };
+const char* const MethodNames[MethodCount] = { "register", "acquire", "release", "unregister" };
+
+struct Options {
+    QString daemon;
+    QString dbusDaemon;
+    QString output;
+    int clients;
+    int cycles;
+    double contention;
+    int slowPeers;
+    quint32 seed;
+    bool threaded;
+    int cpus; // 0: no pinning
+};
+
+struct MethodStats {
+    std::vector<qint64> latencies; // ns
+    int errors = 0;
+};
+
+struct Client {
+    explicit Client(const QDBusConnection& bus)
+        : connection(bus)
+    {
+    }
+
+    QDBusConnection connection;
+    uint id = 0;
+    uint reqno = 0;
+    uint resources = 0;
+    uint priority = 0;
+    int cyclesLeft = 0;
+};
+
+// D-Bus error or a libresource status with a non-zero error code
+bool failed(const QDBusMessage& reply)
+{
+    return reply.type() == QDBusMessage::ErrorMessage || reply.arguments().value(3).toInt() != 0;
+}
+
+qint64 percentile(const std::vector<qint64>& sorted, double q)
+{
+    if (sorted.empty())
+        return 0;
+    const size_t index = std::min(sorted.size() - 1, size_t(q * sorted.size()));
+    return sorted[index];
+}
+
+class LoadBench {
+public:
+    explicit LoadBench(const Options& options)
+        : m_options(options)
+        , m_random(options.seed)
+        , m_running(0)
+    {
+    }
+
+    ~LoadBench() { stop(); }
+
+    bool startBus();
+    bool startDaemon();
+    void spawnSlowPeers();
+    void run();
+    QJsonObject report() const;
+    void stop();
+
+private:
+    void call(Client* client, Method method, const QDBusMessage& message,
+        const std::function<void(const QDBusMessage&)>& next);
+    QDBusMessage request(Client* client, Method method) const;
+
+    void registerClient(Client* client);
+    void acquire(Client* client);
+    void release(Client* client);
+    void unregisterClient(Client* client);
+    void finish();
+
+    Options m_options;
+    QRandomGenerator m_random;
+
+    QTemporaryDir m_dir;
+    QProcess m_bus;
+    QProcess m_daemon;
+    QList<QProcess*> m_slowPeers;
+    QString m_address;
+
+    std::vector<std::unique_ptr<Client>> m_clients;
+    MethodStats m_stats[MethodCount];
+    int m_running;
+    QElapsedTimer m_wallTime;
+    qint64 m_elapsed = 0;
+};
+
+bool LoadBench::startBus()
+{
+    const QString config = m_dir.filePath(QStringLiteral("bus.conf"));
+    QFile file(config);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    file.write(QStringLiteral(R"(<!DOCTYPE busconfig PUBLIC "-//freedesktop//DTD D-BUS Bus Configuration 1.0//EN"
+ "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+<busconfig>
+  <type>session</type>
+  <listen>unix:path=%1</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow send_destination="*" eavesdrop="true"/>
+    <allow eavesdrop="true"/>
+    <allow own="*"/>
+  </policy>
+</busconfig>
+)").arg(m_dir.filePath(QStringLiteral("bus")))
+                   .toUtf8());
+    file.close();
+
+    m_bus.start(m_options.dbusDaemon, { QStringLiteral("--config-file=") + config, QStringLiteral("--nofork"), QStringLiteral("--print-address") });
+    if (!m_bus.waitForStarted() || !m_bus.waitForReadyRead(5000)) {
+        qWarning() << "Cannot start" << m_options.dbusDaemon;
+        return false;
+    }
+
+    m_address = QString::fromUtf8(m_bus.readLine()).trimmed();
+    return !m_address.isEmpty();
+}
+
+bool LoadBench::startDaemon()
+{
+    const QString config = m_dir.filePath(QStringLiteral("resourced.conf"));
+    QFile file(config);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QStringLiteral("[General]\nLogFile=\nFlightRecorder=%1\nStateFile=%2\nThreadedDispatch=%3\n")
+                   .arg(m_dir.filePath(QStringLiteral("flightrecorder")),
+                       m_dir.filePath(QStringLiteral("state")),
+                       m_options.threaded ? QStringLiteral("true") : QStringLiteral("false"))
+                   .toUtf8());
+    file.close();
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("DBUS_SYSTEM_BUS_ADDRESS"), m_address);
+    m_daemon.setProcessEnvironment(env);
+    m_daemon.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    // emulate a device with fewer cores than the build machine
+    if (m_options.cpus > 0) {
+        const int cpus = m_options.cpus;
+        m_daemon.setChildProcessModifier([cpus]() {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu = 0; cpu < cpus; ++cpu)
+                CPU_SET(cpu, &set);
+            ::sched_setaffinity(0, sizeof(set), &set);
+        });
+    }
+
+    m_daemon.start(m_options.daemon, { QStringLiteral("--config"), config });
+    if (!m_daemon.waitForStarted()) {
+        qWarning() << "Cannot start" << m_options.daemon;
+        return false;
+    }
+
+    QDBusConnection control = QDBusConnection::connectToBus(m_address, QStringLiteral("loadbench-control"));
+    for (int i = 0; i < 500; ++i) {
+        if (control.interface()->isServiceRegistered(ManagerService))
+            return true;
+        QThread::msleep(10);
+    }
+
+    qWarning() << "resourced did not show up on the bus";
+    return false;
+}
+
+/**
+ * Peers that register and then stop reading their socket, to check that
+ * nobody else's registration waits for them.
+ */
+void LoadBench::spawnSlowPeers()
+{
+    for (int i = 0; i < m_options.slowPeers; ++i) {
+        auto* peer = new QProcess;
+        peer->setProcessChannelMode(QProcess::ForwardedChannels);
+        peer->start(QCoreApplication::applicationFilePath(),
+            { QStringLiteral("--slow-peer"), QStringLiteral("--address"), m_address });
+        m_slowPeers << peer;
+    }
+}
+
+void LoadBench::run()
+{
+    m_clients.reserve(m_options.clients);
+    for (int i = 0; i < m_options.clients; ++i) {
+        auto client = std::make_unique<Client>(
+            QDBusConnection::connectToBus(m_address, QStringLiteral("loadbench-%1").arg(i)));
+
+        const bool hot = m_random.generateDouble() < m_options.contention;
+        client->resources = hot ? ResourcePolicy::Bit::AudioPlayback
+                                : ColdResources[m_random.bounded(int(std::size(ColdResources)))];
+        client->priority = m_random.bounded(10);
+        client->cyclesLeft = m_options.cycles;
+
+        m_clients.push_back(std::move(client));
+    }
+
+    spawnSlowPeers();
+
+    m_running = m_clients.size();
+    m_wallTime.start();
+    for (const auto& client : m_clients)
+        registerClient(client.get());
+
+    if (m_running > 0)
+        QCoreApplication::exec();
+}
+
+QDBusMessage LoadBench::request(Client* client, Method method) const
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(ManagerService, ManagerPath,
+        ManagerInterface, QLatin1String(MethodNames[method]));
+    message << MethodTypes[method]
+            << client->id
+            << client->reqno;
+    return message;
+}
+
+void LoadBench::call(Client* client, Method method, const QDBusMessage& message,
+    const std::function<void(const QDBusMessage&)>& next)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto* watcher = new QDBusPendingCallWatcher(client->connection.asyncCall(message));
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, watcher,
+        [this, method, timer, next](QDBusPendingCallWatcher* call) {
+            const qint64 elapsed = timer.nsecsElapsed();
+            const QDBusMessage reply = call->reply();
+            call->deleteLater();
+
+            if (failed(reply)) {
+                ++m_stats[method].errors;
+            } else {
+                m_stats[method].latencies.push_back(elapsed);
+            }
+
+            next(reply);
+        });
+}
+
+void LoadBench::registerClient(Client* client)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(ManagerService, ManagerPath,
+        ManagerInterface, QStringLiteral("register"));
+    message << MethodTypes[Register]
+            << client->id
+            << ++client->reqno
+            << client->resources // mandatory
+            << uint(0) // optional
+            << uint(0) // share
+            << uint(0) // mask
+            << QStringLiteral("player")
+            << QString()
+            << client->priority;
+
+    call(client, Register, message, [this, client](const QDBusMessage& reply) {
+        if (failed(reply)) {
+            finish();
+            return;
+        }
+        client->id = reply.arguments().value(1).toUInt();
+        acquire(client);
+    });
+}
+
+void LoadBench::acquire(Client* client)
+{
+    ++client->reqno;
+    call(client, Acquire, request(client, Acquire), [this, client](const QDBusMessage&) {
+        release(client);
+    });
+}
+
+void LoadBench::release(Client* client)
+{
+    ++client->reqno;
+    call(client, Release, request(client, Release), [this, client](const QDBusMessage&) {
+        if (--client->cyclesLeft > 0)
+            acquire(client);
+        else
+            unregisterClient(client);
+    });
+}
+
+void LoadBench::unregisterClient(Client* client)
+{
+    ++client->reqno;
+    call(client, Unregister, request(client, Unregister), [this](const QDBusMessage&) {
+        finish();
+    });
+}
+
+void LoadBench::finish()
+{
+    if (--m_running == 0) {
+        m_elapsed = m_wallTime.nsecsElapsed();
+        QCoreApplication::quit();
+    }
+}
+
+QJsonObject LoadBench::report() const
+{
+    QJsonObject methods;
+    for (int m = 0; m < MethodCount; ++m) {
+        std::vector<qint64> sorted = m_stats[m].latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        const double seconds = m_elapsed / 1e9;
+        QJsonObject method;
+        method[QStringLiteral("calls")] = qint64(sorted.size());
+        method[QStringLiteral("errors")] = m_stats[m].errors;
+        method[QStringLiteral("throughput_per_s")] = seconds > 0 ? sorted.size() / seconds : 0.0;
+        method[QStringLiteral("p50_us")] = percentile(sorted, 0.50) / 1e3;
+        method[QStringLiteral("p99_us")] = percentile(sorted, 0.99) / 1e3;
+        method[QStringLiteral("p999_us")] = percentile(sorted, 0.999) / 1e3;
+        method[QStringLiteral("max_us")] = sorted.empty() ? 0.0 : sorted.back() / 1e3;
+        methods[QLatin1String(MethodNames[m])] = method;
+    }
+
+    QJsonObject result;
+    result[QStringLiteral("clients")] = m_options.clients;
+    result[QStringLiteral("cycles")] = m_options.cycles;
+    result[QStringLiteral("contention")] = m_options.contention;
+    result[QStringLiteral("slow_peers")] = m_options.slowPeers;
+    result[QStringLiteral("seed")] = qint64(m_options.seed);
+    result[QStringLiteral("dispatch")] = m_options.threaded ? QStringLiteral("threaded") : QStringLiteral("inline");
+    result[QStringLiteral("cpus")] = m_options.cpus;
+    result[QStringLiteral("wall_time_ms")] = m_elapsed / 1e6;
+    result[QStringLiteral("methods")] = methods;
+    return result;
+}
+
+void LoadBench::stop()
+{
+    for (QProcess* peer : std::as_const(m_slowPeers)) {
+        peer->kill();
+        peer->waitForFinished();
+        delete peer;
+    }
+    m_slowPeers.clear();
+
+    if (m_daemon.state() != QProcess::NotRunning) {
+        m_daemon.terminate();
+        if (!m_daemon.waitForFinished(2000))
+            m_daemon.kill();
+    }
+
+    if (m_bus.state() != QProcess::NotRunning) {
+        m_bus.terminate();
+        m_bus.waitForFinished();
+    }
+}
+
+/**
+ * --slow-peer mode: register once, then stop without ever reading the
+ * socket again.
+ */
+int runSlowPeer(const QString& address)
+{
+    QDBusConnection bus = QDBusConnection::connectToBus(address, QStringLiteral("slow-peer"));
+    if (!bus.isConnected())
+        return 1;
+
+    QDBusMessage message = QDBusMessage::createMethodCall(ManagerService, ManagerPath,
+        ManagerInterface, QStringLiteral("register"));
+    message << MethodTypes[Register] << uint(0) << uint(1)
+            << uint(ResourcePolicy::Bit::AudioPlayback) << uint(0) << uint(0) << uint(0)
+            << QStringLiteral("player") << QString() << uint(0);
+    bus.asyncCall(message);
+
+    // give the connection thread time to flush the call
+    QThread::msleep(50);
+    ::raise(SIGSTOP);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("resourced-loadbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load benchmark for resourced on a private bus");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "daemon", "resourced binary to benchmark.", "path", "resourced" },
+        { "dbus-daemon", "dbus-daemon binary.", "path", "dbus-daemon" },
+        { "clients", "Number of simulated clients.", "n", "50" },
+        { "cycles", "acquire/release cycles per client.", "n", "100" },
+        { "contention", "Share of clients fighting for AudioPlayback (0..1).", "ratio", "0.5" },
+        { "slow-peers", "Peers that register and then stop responding.", "n", "0" },
+        { "seed", "Random seed.", "n", "1" },
+        { "dispatch", "threaded: bus I/O and arbitration in separate threads, inline: one thread.", "mode", "threaded" },
+        { "cpus", "Pin resourced to the first <n> CPUs, 0 for no pinning.", "n", "0" },
+        { "output", "Write the JSON report to a file instead of stdout.", "path" },
+        { "slow-peer", "Internal: run as an unresponsive peer." },
+        { "address", "Internal: bus address for --slow-peer.", "address" },
+    });
+    parser.process(app);
+
+    if (parser.isSet("slow-peer"))
+        return runSlowPeer(parser.value("address"));
+
+    Options options;
+    options.daemon = parser.value("daemon");
+    options.dbusDaemon = parser.value("dbus-daemon");
+    options.output = parser.value("output");
+    options.clients = parser.value("clients").toInt();
+    options.cycles = std::max(1, parser.value("cycles").toInt());
+    options.contention = std::clamp(parser.value("contention").toDouble(), 0.0, 1.0);
+    options.slowPeers = parser.value("slow-peers").toInt();
+    options.seed = parser.value("seed").toUInt();
+    options.threaded = parser.value("dispatch") != QLatin1String("inline");
+    options.cpus = parser.value("cpus").toInt();
+
+    LoadBench bench(options);
+    if (!bench.startBus() || !bench.startDaemon())
+        return 1;
+
+    bench.run();
+    const QByteArray json = QJsonDocument(bench.report()).toJson();
+    bench.stop();
+
+    if (options.output.isEmpty()) {
+        QFile out;
+        if (out.open(stdout, QIODevice::WriteOnly))
+            out.write(json);
+    } else {
+        QFile out(options.output);
+        if (!out.open(QIODevice::WriteOnly)) {
+            qWarning() << "Cannot write" << options.output;
+            return 1;
+        }
+        out.write(json);
+    }
+
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Arbitration behaviour as the clients see it: the notifications the
+ * ResourceManager emits for the requests of its clients.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "core/resourcetypes.h"
+#include "util/config.h"
+
+#include <QDBusMessage>
+#include <QTemporaryFile>
+#include <QtTest>
+
+#include <algorithm>
+
+namespace {
+
+namespace Atom = ResourcePolicy::Atom;
+namespace Bit = ResourcePolicy::Bit;
+using ResourcePolicy::ResourceMask;
+
+struct Notification {
+    ResourceClient* client;
+    ResourceClient::Event event;
+    ResourceMask resources;
+
+    bool operator==(const Notification&) const = default;
+};
+
+QDBusMessage registerMessage(int peer)
+{
+    return QDBusMessage::createMethodCall(QStringLiteral(":1.%1").arg(peer),
+        QStringLiteral("/org/maemo/resource/manager"),
+        QStringLiteral("org.maemo.resource.manager"),
+        QStringLiteral("register"));
+}
+
+} // namespace
+
+class TestArbitration : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void contestedMandatory();
+    void optionalHandOff();
+    void sharedJoinAndLeave();
+    void sharedHandOff();
+    void reapService();
+    void holdTime();
+    void holdTimeBand();
+    void holdTimeRuleOverride();
+    void pairLimit();
+
+private:
+    bool loadConfig(const QByteArray& contents);
+    ResourceClient* createClient(int priority, ResourceMask mandatory, ResourceMask optional = 0, ResourceMask share = 0);
+    bool notified(ResourceClient* client, ResourceClient::Event event) const;
+
+    ResourceManager* m_manager = nullptr;
+    QList<Notification> m_notifications;
+    int m_lastPeer = 0;
+};
+
+void TestArbitration::init()
+{
+    m_manager = new ResourceManager;
+    m_notifications.clear();
+    connect(m_manager, &ResourceManager::clientNotified, this,
+        [this](ResourceClient* client, ResourceClient::Event event, ResourceMask resources) {
+            m_notifications.append({ client, event, resources });
+        });
+}
+
+void TestArbitration::cleanup()
+{
+    delete m_manager;
+    m_manager = nullptr;
+}
+
+bool TestArbitration::loadConfig(const QByteArray& contents)
+{
+    QTemporaryFile file;
+    if (!file.open())
+        return false;
+    file.write(contents);
+    file.close();
+    return m_manager->config()->load(file.fileName());
+}
+
+ResourceClient* TestArbitration::createClient(int priority, ResourceMask mandatory, ResourceMask optional, ResourceMask share)
+{
+    ResourceClient* client = m_manager->createClient(registerMessage(++m_lastPeer), priority);
+    client->setResourceSet(mandatory, optional, share, 0);
+    return client;
+}
+
+bool TestArbitration::notified(ResourceClient* client, ResourceClient::Event event) const
+{
+    return std::any_of(m_notifications.cbegin(), m_notifications.cend(), [client, event](const Notification& notification) {
+        return notification.client == client && notification.event == event;
+    });
+}
+
+/* one owner would yield, the other not: nobody is preempted, nothing granted */
+void TestArbitration::contestedMandatory()
+{
+    ResourceClient* weak = createClient(5, Bit::AudioPlayback);
+    ResourceClient* strong = createClient(20, Bit::VideoPlayback);
+    QCOMPARE(m_manager->requestResources(weak, Bit::AudioPlayback), Bit::AudioPlayback);
+    QCOMPARE(m_manager->requestResources(strong, Bit::VideoPlayback), Bit::VideoPlayback);
+    m_notifications.clear();
+
+    ResourceClient* client = createClient(10, Bit::AudioPlayback | Bit::VideoPlayback);
+    QCOMPARE(m_manager->requestResources(client, Bit::AudioPlayback | Bit::VideoPlayback), ResourceMask(0));
+
+    QCOMPARE(m_notifications, (QList<Notification> { { client, ResourceClient::Denied, Bit::AudioPlayback | Bit::VideoPlayback } }));
+    QCOMPARE(weak->resources(), Bit::AudioPlayback);
+    QCOMPARE(strong->resources(), Bit::VideoPlayback);
+}
+
+/* a freed optional bit skips a waiter that lacks its mandatory set */
+void TestArbitration::optionalHandOff()
+{
+    ResourceClient* audioOwner = createClient(30, Bit::AudioPlayback);
+    ResourceClient* vibraOwner = createClient(30, Bit::Vibra);
+    m_manager->requestResources(audioOwner, Bit::AudioPlayback);
+    m_manager->requestResources(vibraOwner, Bit::Vibra);
+
+    // best ranked waiter, but its mandatory AudioPlayback stays taken
+    ResourceClient* partial = createClient(20, Bit::AudioPlayback, Bit::Vibra);
+    m_manager->requestResources(partial, Bit::AudioPlayback | Bit::Vibra);
+    ResourceClient* complete = createClient(10, Bit::Vibra);
+    m_manager->requestResources(complete, Bit::Vibra);
+    QCOMPARE(m_manager->waitingResources(partial), Bit::AudioPlayback | Bit::Vibra);
+    QCOMPARE(m_manager->waitingResources(complete), Bit::Vibra);
+    m_notifications.clear();
+
+    m_manager->releaseAll(vibraOwner);
+
+    QVERIFY(!notified(partial, ResourceClient::Granted));
+    QCOMPARE(partial->resources(), ResourceMask(0));
+    QCOMPARE(m_notifications, (QList<Notification> { { complete, ResourceClient::Granted, Bit::Vibra } }));
+    QCOMPARE(m_manager->waitingResources(partial), Bit::AudioPlayback | Bit::Vibra);
+}
+
+/* shared holders join without preempting, the resource is free with the last one */
+void TestArbitration::sharedJoinAndLeave()
+{
+    ResourceClient* first = createClient(10, Bit::AudioPlayback, 0, Bit::AudioPlayback);
+    ResourceClient* second = createClient(5, Bit::AudioPlayback, 0, Bit::AudioPlayback);
+
+    m_manager->requestResources(first, Bit::AudioPlayback);
+    m_manager->requestResources(second, Bit::AudioPlayback);
+
+    QCOMPARE(m_notifications, (QList<Notification> {
+                                  { first, ResourceClient::Granted, Bit::AudioPlayback },
+                                  { second, ResourceClient::Granted, Bit::AudioPlayback } }));
+    QCOMPARE(m_manager->ownerCount(Atom::AudioPlayback), 2);
+    QCOMPARE(m_manager->sharedResources(), Bit::AudioPlayback);
+    m_notifications.clear();
+
+    m_manager->releaseAll(first);
+    QVERIFY(m_notifications.isEmpty());
+    QCOMPARE(m_manager->ownerCount(Atom::AudioPlayback), 1);
+    QCOMPARE(m_manager->owner(Atom::AudioPlayback), second);
+
+    m_manager->releaseAll(second);
+    QVERIFY(m_notifications.isEmpty());
+    QCOMPARE(m_manager->ownedResources(), ResourceMask(0));
+    QCOMPARE(m_manager->sharedResources(), ResourceMask(0));
+}
+
+/* a resource handed over in shared mode goes to all waiting sharers */
+void TestArbitration::sharedHandOff()
+{
+    ResourceClient* owner = createClient(10, Bit::AudioPlayback);
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+
+    ResourceClient* first = createClient(5, Bit::AudioPlayback, 0, Bit::AudioPlayback);
+    ResourceClient* exclusive = createClient(4, Bit::AudioPlayback);
+    ResourceClient* second = createClient(3, Bit::AudioPlayback, 0, Bit::AudioPlayback);
+    for (ResourceClient* client : { first, exclusive, second })
+        m_manager->requestResources(client, Bit::AudioPlayback);
+    m_notifications.clear();
+
+    m_manager->releaseAll(owner);
+
+    QCOMPARE(m_notifications, (QList<Notification> {
+                                  { first, ResourceClient::Granted, Bit::AudioPlayback },
+                                  { second, ResourceClient::Granted, Bit::AudioPlayback } }));
+    QCOMPARE(m_manager->ownerCount(Atom::AudioPlayback), 2);
+    QCOMPARE(m_manager->waitingResources(exclusive), Bit::AudioPlayback);
+    QCOMPARE(m_manager->waitingResources(second), ResourceMask(0));
+}
+
+/* a peer that left the bus: its sets go, their resources to the waiters */
+void TestArbitration::reapService()
+{
+    const QString peer = QStringLiteral(":1.100");
+    ResourceClient* player = m_manager->createClient(peer, 10);
+    player->setResourceSet(Bit::AudioPlayback, 0, 0, 0);
+    ResourceClient* vibra = m_manager->createClient(peer, 10);
+    vibra->setResourceSet(Bit::Vibra, 0, 0, 0);
+    m_manager->requestResources(player, Bit::AudioPlayback);
+    m_manager->requestResources(vibra, Bit::Vibra);
+    const uint playerId = player->clientID();
+    const uint vibraId = vibra->clientID();
+
+    ResourceClient* waiter = createClient(5, Bit::AudioPlayback);
+    m_manager->requestResources(waiter, Bit::AudioPlayback);
+    QCOMPARE(m_manager->waitingResources(waiter), Bit::AudioPlayback);
+    m_notifications.clear();
+
+    QCOMPARE(m_manager->destroyClientsForService(peer), 2);
+
+    QCOMPARE(m_manager->clientById(playerId), nullptr);
+    QCOMPARE(m_manager->clientById(vibraId), nullptr);
+    QVERIFY(m_manager->clientsForService(peer).isEmpty());
+    QCOMPARE(m_manager->clientCount(), qsizetype(1));
+    QCOMPARE(m_manager->ownedResources(), Bit::AudioPlayback);
+    QCOMPARE(m_notifications, (QList<Notification> { { waiter, ResourceClient::Granted, Bit::AudioPlayback } }));
+    QCOMPARE(m_manager->waitingResources(waiter), ResourceMask(0));
+}
+
+/* a fresh owner keeps its resource for MinHoldTime, then the damped request is decided again */
+void TestArbitration::holdTime()
+{
+    QVERIFY(loadConfig("[Preemption]\nMinHoldTime=100\nDampingPriorityBand=10\n"));
+
+    ResourceClient* owner = createClient(5, Bit::AudioPlayback);
+    ResourceClient* client = createClient(10, Bit::AudioPlayback);
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+    m_notifications.clear();
+
+    QCOMPARE(m_manager->requestResources(client, Bit::AudioPlayback), ResourceMask(0));
+    QCOMPARE(m_notifications, (QList<Notification> { { client, ResourceClient::Denied, Bit::AudioPlayback } }));
+    QCOMPARE(owner->resources(), Bit::AudioPlayback);
+
+    // no release needed, the expired hold re-arms the decision
+    QTRY_COMPARE(client->resources(), Bit::AudioPlayback);
+    QVERIFY(notified(owner, ResourceClient::Lost));
+    QCOMPARE(m_manager->waitingResources(client), ResourceMask(0));
+}
+
+/* clients of clearly different priority are never damped */
+void TestArbitration::holdTimeBand()
+{
+    QVERIFY(loadConfig("[Preemption]\nMinHoldTime=10000\nDampingPriorityBand=10\n"));
+
+    ResourceClient* owner = createClient(5, Bit::AudioPlayback);
+    ResourceClient* client = createClient(50, Bit::AudioPlayback);
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+    m_notifications.clear();
+
+    QCOMPARE(m_manager->requestResources(client, Bit::AudioPlayback), Bit::AudioPlayback);
+    QCOMPARE(m_notifications, (QList<Notification> {
+                                  { owner, ResourceClient::Lost, Bit::AudioPlayback },
+                                  { client, ResourceClient::Granted, Bit::AudioPlayback } }));
+}
+
+/* a preemption the rule table allows is never damped */
+void TestArbitration::holdTimeRuleOverride()
+{
+    QVERIFY(loadConfig("[Preemption]\nMinHoldTime=10000\nDampingPriorityBand=100\n"
+                       "[PreemptionRules]\ncall>*=*\n"));
+
+    ResourceClient* owner = createClient(10, Bit::AudioPlayback);
+    ResourceClient* call = createClient(10, Bit::AudioPlayback);
+    m_manager->setClientClass(owner, QStringLiteral("player"), QString());
+    m_manager->setClientClass(call, QStringLiteral("call"), QString());
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+    m_notifications.clear();
+
+    QCOMPARE(m_manager->requestResources(call, Bit::AudioPlayback), Bit::AudioPlayback);
+    QVERIFY(notified(owner, ResourceClient::Lost));
+    QVERIFY(!notified(call, ResourceClient::Denied));
+}
+
+/* a pair preempts each other at most PairPreemptionLimit times per window */
+void TestArbitration::pairLimit()
+{
+    QVERIFY(loadConfig("[Preemption]\nPairPreemptionLimit=2\nPairPreemptionWindow=60000\nDampingPriorityBand=10\n"));
+
+    ResourceClient* owner = createClient(5, Bit::AudioPlayback);
+    ResourceClient* client = createClient(10, Bit::AudioPlayback);
+
+    for (int i = 0; i < 2; ++i) {
+        m_manager->requestResources(owner, Bit::AudioPlayback);
+        QCOMPARE(m_manager->requestResources(client, Bit::AudioPlayback), Bit::AudioPlayback);
+        QVERIFY(notified(owner, ResourceClient::Lost));
+        m_manager->releaseAll(client);
+        m_manager->releaseAll(owner);
+        m_notifications.clear();
+    }
+
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+    m_notifications.clear();
+
+    QCOMPARE(m_manager->requestResources(client, Bit::AudioPlayback), ResourceMask(0));
+    QCOMPARE(m_notifications, (QList<Notification> { { client, ResourceClient::Denied, Bit::AudioPlayback } }));
+    QCOMPARE(owner->resources(), Bit::AudioPlayback);
+    QVERIFY(m_manager->stats().counter(Statistics::SuppressedFlips) > 0);
+}
+
+QTEST_GUILESS_MAIN(TestArbitration)
+#include "test_arbitration.moc"
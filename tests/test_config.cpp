@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * resourced.conf parsing and reloading.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "dbus/manageradaptor.h"
+#include "util/config.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+class TestConfig : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void defaults();
+    void parse();
+    void missingFile();
+    void reload();
+    void reclassifyOnReload();
+    void reloadCallRejected();
+
+private:
+    QString write(const QByteArray& contents);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void TestConfig::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+QString TestConfig::write(const QByteArray& contents)
+{
+    const QString path = m_dir->filePath(QStringLiteral("resourced.conf"));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QString();
+    file.write(contents);
+    return path;
+}
+
+void TestConfig::defaults()
+{
+    Config config;
+    const PolicySnapshot* snapshot = config.snapshot();
+    const PolicySnapshot defaults;
+
+    QCOMPARE(snapshot->generation, quint64(0));
+    QCOMPARE(snapshot->dbusService, defaults.dbusService);
+    QCOMPARE(snapshot->defaultClientPriority, 0);
+    QCOMPARE(snapshot->enablePreemption, true);
+    QCOMPARE(snapshot->minHoldTime, 0);
+    QCOMPARE(snapshot->preemptionRules.classCount(), 1);
+}
+
+/* given keys are read, missing ones keep their defaults */
+void TestConfig::parse()
+{
+    const QString path = write("[General]\n"
+                               "DefaultClientPriority=7\n"
+                               "ThreadedDispatch=false\n"
+                               "Bus=Session\n"
+                               "[Preemption]\n"
+                               "EnablePreemption=false\n"
+                               "Policy=fifo\n"
+                               "MinHoldTime=150\n"
+                               "DampingPriorityBand=3\n");
+    Config config;
+    QVERIFY(config.load(path));
+
+    const PolicySnapshot* snapshot = config.snapshot();
+    const PolicySnapshot defaults;
+    QCOMPARE(snapshot->generation, quint64(1));
+    QCOMPARE(snapshot->defaultClientPriority, 7);
+    QCOMPARE(snapshot->threadedDispatch, false);
+    QCOMPARE(snapshot->sessionBus, true);
+    QCOMPARE(snapshot->enablePreemption, false);
+    QCOMPARE(snapshot->policy, PolicyKind::Fifo);
+    QCOMPARE(snapshot->minHoldTime, 150);
+    QCOMPARE(snapshot->dampingPriorityBand, 3);
+
+    QCOMPARE(snapshot->dbusPath, defaults.dbusPath);
+    QCOMPARE(snapshot->stateCapacity, defaults.stateCapacity);
+    QCOMPARE(snapshot->pairPreemptionWindow, defaults.pairPreemptionWindow);
+}
+
+/* a file that cannot be read keeps the current snapshot */
+void TestConfig::missingFile()
+{
+    Config config;
+    QVERIFY(config.load(write("[General]\nDefaultClientPriority=7\n")));
+    QSignalSpy reloaded(&config, &Config::reloaded);
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("Config file not found")));
+    QVERIFY(!config.load(m_dir->filePath(QStringLiteral("missing.conf"))));
+
+    QCOMPARE(config.snapshot()->generation, quint64(1));
+    QCOMPARE(config.snapshot()->defaultClientPriority, 7);
+    QCOMPARE(reloaded.count(), 0);
+}
+
+/* reload publishes a new snapshot from the same path */
+void TestConfig::reload()
+{
+    Config config;
+    QVERIFY(config.load(write("[Preemption]\nMinHoldTime=100\n")));
+    QSignalSpy reloaded(&config, &Config::reloaded);
+
+    write("[Preemption]\nMinHoldTime=300\nPairPreemptionLimit=2\n");
+    QVERIFY(config.reload());
+
+    QCOMPARE(reloaded.count(), 1);
+    QCOMPARE(config.snapshot()->generation, quint64(2));
+    QCOMPARE(config.snapshot()->minHoldTime, 300);
+    QCOMPARE(config.snapshot()->pairPreemptionLimit, 2);
+}
+
+/* class ids index one table, the manager resolves them again after a reload */
+void TestConfig::reclassifyOnReload()
+{
+    ResourceManager manager;
+    QVERIFY(manager.config()->load(write("[PreemptionRules]\ncall>*=*\nplayer>call=\n")));
+
+    ResourceClient* call = manager.createClient(QStringLiteral(":1.1"), 0);
+    ResourceClient* player = manager.createClient(QStringLiteral(":1.2"), 0);
+    manager.setClientClass(call, QStringLiteral("call"), QString());
+    manager.setClientClass(player, QStringLiteral("player"), QString());
+    QVERIFY(call->classId() != PreemptionTable::Unclassified);
+    QVERIFY(player->classId() != PreemptionTable::Unclassified);
+
+    // new classes first, "player" is no longer named
+    write("[PreemptionRules]\nalarm>navigator=AudioPlayback\ncall>alarm=*\n");
+    QVERIFY(manager.config()->reload());
+
+    const PreemptionTable& rules = manager.config()->snapshot()->preemptionRules;
+    QCOMPARE(call->classId(), rules.classId(QStringLiteral("call")));
+    QVERIFY(call->classId() != PreemptionTable::Unclassified);
+    QCOMPARE(player->classId(), PreemptionTable::Unclassified);
+}
+
+/* Config.Reload needs a caller the bus vouches for as root */
+void TestConfig::reloadCallRejected()
+{
+    ResourceManager manager;
+    QVERIFY(manager.config()->load(write("[Preemption]\nMinHoldTime=100\n")));
+    ManagerAdaptor adaptor(&manager);
+
+    write("[Preemption]\nMinHoldTime=300\n");
+    const QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral(":1.1"),
+        QStringLiteral("/org/maemo/resource/manager"),
+        QStringLiteral("org.maemo.resource.manager.Config"),
+        QStringLiteral("Reload"));
+    QVERIFY(adaptor.handleMessage(message, QDBusConnection(QStringLiteral("test-disconnected"))));
+    QCoreApplication::processEvents();
+
+    QCOMPARE(manager.config()->snapshot()->generation, quint64(1));
+    QCOMPARE(manager.config()->snapshot()->minHoldTime, 100);
+}
+
+QTEST_GUILESS_MAIN(TestConfig)
+#include "test_config.moc"
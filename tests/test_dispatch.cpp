@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Calls through the manager adaptor, no bus involved: replies go to a
+ * connection that is not connected and are dropped.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "dbus/manageradaptor.h"
+#include "util/statistics.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QtTest>
+
+namespace {
+
+namespace Bit = ResourcePolicy::Bit;
+using ResourcePolicy::ResourceMask;
+
+QDBusMessage managerCall(const QString& member)
+{
+    return QDBusMessage::createMethodCall(QStringLiteral(":1.1"),
+        QStringLiteral("/org/maemo/resource/manager"),
+        QStringLiteral("org.maemo.resource.manager"),
+        member);
+}
+
+} // namespace
+
+class TestDispatch : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void retriedAcquire();
+
+private:
+    bool acquire(ResourceClient* client, uint reqno);
+
+    ResourceManager* m_manager = nullptr;
+    ManagerAdaptor* m_adaptor = nullptr;
+    int m_denials = 0;
+    QDBusConnection m_connection { QStringLiteral("test-disconnected") };
+};
+
+void TestDispatch::init()
+{
+    m_manager = new ResourceManager;
+    m_adaptor = new ManagerAdaptor(m_manager);
+    m_denials = 0;
+    connect(m_manager, &ResourceManager::clientNotified, this,
+        [this](ResourceClient*, ResourceClient::Event event, ResourceMask) {
+            if (event == ResourceClient::Denied)
+                ++m_denials;
+        });
+}
+
+void TestDispatch::cleanup()
+{
+    delete m_adaptor;
+    m_adaptor = nullptr;
+    delete m_manager;
+    m_manager = nullptr;
+}
+
+bool TestDispatch::acquire(ResourceClient* client, uint reqno)
+{
+    QDBusMessage message = managerCall(QStringLiteral("acquire"));
+    message << 3 << client->clientID() << reqno;
+    return m_adaptor->handleMessage(message, m_connection);
+}
+
+/* libresource resends a request it got no answer for, with the same reqno */
+void TestDispatch::retriedAcquire()
+{
+    ResourceClient* owner = m_manager->createClient(QStringLiteral(":1.2"), 20);
+    owner->setResourceSet(Bit::AudioPlayback, 0, 0, 0);
+    m_manager->requestResources(owner, Bit::AudioPlayback);
+
+    // every arbitration of its acquire ends in a denial
+    ResourceClient* client = m_manager->createClient(managerCall(QString()), 5);
+    client->setResourceSet(Bit::AudioPlayback, 0, 0, 0);
+
+    QVERIFY(acquire(client, 1));
+    QCOMPARE(m_denials, 1);
+
+    // retry: the cached status, no second decision
+    QVERIFY(acquire(client, 1));
+    QCOMPARE(m_denials, 1);
+    QCOMPARE(m_manager->stats().counter(Statistics::Duplicates), quint64(1));
+
+    // a new reqno is decided again
+    QVERIFY(acquire(client, 2));
+    QCOMPARE(m_denials, 2);
+
+    // the cache keeps the last four, reqno 1 drops out with the fifth
+    for (uint reqno : { 3, 4, 5 })
+        QVERIFY(acquire(client, reqno));
+    QCOMPARE(m_denials, 5);
+
+    QVERIFY(acquire(client, 1));
+    QCOMPARE(m_denials, 6);
+    QCOMPARE(m_manager->stats().counter(Statistics::Duplicates), quint64(1));
+
+    QVERIFY(acquire(client, 4));
+    QCOMPARE(m_denials, 6);
+    QCOMPARE(m_manager->stats().counter(Statistics::Duplicates), quint64(2));
+}
+
+QTEST_GUILESS_MAIN(TestDispatch)
+#include "test_dispatch.moc"
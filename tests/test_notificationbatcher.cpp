@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Coalescing of grant() notifications, without a bus: the messages are
+ * captured by the batcher's sender.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "dbus/notificationbatcher.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QtTest>
+
+namespace {
+
+namespace Bit = ResourcePolicy::Bit;
+using ResourcePolicy::ResourceMask;
+
+struct Grant {
+    uint id;
+    uint reqno;
+    ResourceMask resources;
+
+    bool operator==(const Grant&) const = default;
+};
+
+} // namespace
+
+class TestNotificationBatcher : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void coalesce();
+    void secondRequest();
+    void destroyedClient();
+
+private:
+    ResourceManager* m_manager = nullptr;
+    NotificationBatcher* m_batcher = nullptr;
+    QList<Grant> m_grants;
+    QDBusConnection m_connection { QStringLiteral("test-disconnected") };
+};
+
+void TestNotificationBatcher::init()
+{
+    m_manager = new ResourceManager;
+    m_batcher = new NotificationBatcher(m_manager);
+    m_grants.clear();
+    m_batcher->setSender([this](const QDBusConnection&, const QDBusMessage& message) {
+        const QVariantList args = message.arguments();
+        m_grants.append({ args.value(1).toUInt(), args.value(2).toUInt(), args.value(3).toUInt() });
+    });
+}
+
+void TestNotificationBatcher::cleanup()
+{
+    delete m_batcher;
+    m_batcher = nullptr;
+    delete m_manager;
+    m_manager = nullptr;
+}
+
+/* changes within one iteration go out as one grant with the final mask */
+void TestNotificationBatcher::coalesce()
+{
+    ResourceClient* client = m_manager->createClient(QStringLiteral(":1.1"), 0);
+    client->setResourceSet(Bit::AudioPlayback, Bit::Vibra, 0, 0);
+
+    m_manager->requestResources(client, Bit::AudioPlayback);
+    m_batcher->queueGrant(client, 7, m_connection);
+    m_manager->requestResources(client, Bit::Vibra);
+    m_batcher->queueGrant(client, 0, m_connection);
+    QVERIFY(m_grants.isEmpty());
+
+    QTRY_COMPARE(m_grants, (QList<Grant> { { client->clientID(), 7, Bit::AudioPlayback | Bit::Vibra } }));
+    QCOMPARE(m_batcher->queuedNotifications(), quint64(2));
+    QCOMPARE(m_batcher->savedMessages(), quint64(1));
+}
+
+/* acquire and release in one iteration: each reqno is answered with its own outcome */
+void TestNotificationBatcher::secondRequest()
+{
+    ResourceClient* client = m_manager->createClient(QStringLiteral(":1.1"), 0);
+    client->setResourceSet(Bit::AudioPlayback, 0, 0, 0);
+
+    m_manager->requestResources(client, Bit::AudioPlayback);
+    m_batcher->queueGrant(client, 1, m_connection);
+    m_manager->releaseAll(client);
+    m_batcher->queueGrant(client, 2, m_connection);
+    m_batcher->queueGrant(client, 0, m_connection);
+
+    m_batcher->flush();
+    QCOMPARE(m_grants, (QList<Grant> {
+                           { client->clientID(), 1, Bit::AudioPlayback },
+                           { client->clientID(), 2, 0 } }));
+}
+
+/* a set unregistered before the flush gets nothing */
+void TestNotificationBatcher::destroyedClient()
+{
+    ResourceClient* client = m_manager->createClient(QStringLiteral(":1.1"), 0);
+    client->setResourceSet(Bit::AudioPlayback, 0, 0, 0);
+
+    m_manager->requestResources(client, Bit::AudioPlayback);
+    m_batcher->queueGrant(client, 1, m_connection);
+    m_manager->destroyClient(client);
+
+    m_batcher->flush();
+    QVERIFY(m_grants.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestNotificationBatcher)
+#include "test_notificationbatcher.moc"
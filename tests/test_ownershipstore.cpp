@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Ownership persisted by one ResourceManager and restored by the next,
+ * as across a daemon restart.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "core/resourcetypes.h"
+#include "util/ownershipstore.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+namespace {
+
+namespace Bit = ResourcePolicy::Bit;
+using ResourcePolicy::ResourceMask;
+
+constexpr quint32 Capacity = 16;
+
+struct Notification {
+    ResourceClient* client;
+    ResourceClient::Event event;
+    ResourceMask resources;
+
+    bool operator==(const Notification&) const = default;
+};
+
+OwnershipStore::Entry entry(uint id, const QString& service, ResourceMask granted)
+{
+    OwnershipStore::Entry entry;
+    entry.id = id;
+    entry.priority = 10;
+    entry.mandatory = granted;
+    entry.granted = granted;
+    entry.service = service;
+    return entry;
+}
+
+} // namespace
+
+class TestOwnershipStore : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void roundTrip();
+    void vanishedService();
+    void doubleClaim();
+    void truncatedService();
+
+private:
+    QString statePath() const { return m_dir->filePath(QStringLiteral("state")); }
+    void write(const QList<OwnershipStore::Entry>& entries);
+    void record(ResourceManager& manager);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QList<Notification> m_notifications;
+};
+
+void TestOwnershipStore::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_notifications.clear();
+}
+
+void TestOwnershipStore::record(ResourceManager& manager)
+{
+    connect(&manager, &ResourceManager::clientNotified, this,
+        [this](ResourceClient* client, ResourceClient::Event event, ResourceMask resources) {
+            m_notifications.append({ client, event, resources });
+        });
+}
+
+/* what a crashed daemon left behind */
+void TestOwnershipStore::write(const QList<OwnershipStore::Entry>& entries)
+{
+    OwnershipStore store;
+    QVERIFY(store.open(statePath(), Capacity));
+    for (const OwnershipStore::Entry& entry : entries)
+        store.store(entry);
+}
+
+void TestOwnershipStore::roundTrip()
+{
+    uint id = 0;
+    {
+        ResourceManager manager;
+        QVERIFY(manager.store().open(statePath(), Capacity));
+
+        ResourceClient* client = manager.createClient(QStringLiteral(":1.5"), 15);
+        client->setClientType(3);
+        client->setResourceSet(Bit::AudioPlayback, Bit::Vibra, Bit::AudioPlayback, 0);
+        manager.setClientClass(client, QStringLiteral("player"), QStringLiteral("shared"));
+        manager.persistClient(client);
+        manager.requestResources(client, Bit::AudioPlayback | Bit::Vibra);
+        id = client->clientID();
+    }
+
+    ResourceManager manager;
+    QVERIFY(manager.store().open(statePath(), Capacity));
+    record(manager);
+
+    const QList<ResourceClient*> restored = manager.restoreClients({ QStringLiteral(":1.5") });
+    QCOMPARE(restored.size(), 1);
+    ResourceClient* client = restored.first();
+    QCOMPARE(client->clientID(), id);
+    QCOMPARE(client->serviceName(), QStringLiteral(":1.5"));
+    QCOMPARE(client->priority(), 15);
+    QCOMPARE(client->clientType(), 3);
+    QCOMPARE(client->mandatory(), Bit::AudioPlayback);
+    QCOMPARE(client->optional(), Bit::Vibra);
+    QCOMPARE(client->share(), Bit::AudioPlayback);
+    QCOMPARE(client->clientClass(), QStringLiteral("player"));
+    QCOMPARE(client->mode(), QStringLiteral("shared"));
+    QCOMPARE(client->resources(), Bit::AudioPlayback | Bit::Vibra);
+    QCOMPARE(manager.ownedResources(), Bit::AudioPlayback | Bit::Vibra);
+    QVERIFY(m_notifications.isEmpty());
+
+    // new sets continue after the restored ids
+    QVERIFY(manager.createClient(QStringLiteral(":1.6"), 0)->clientID() > id);
+}
+
+void TestOwnershipStore::vanishedService()
+{
+    write({ entry(1, QStringLiteral(":1.5"), Bit::AudioPlayback), entry(2, QStringLiteral(":1.6"), Bit::Vibra) });
+
+    ResourceManager manager;
+    QVERIFY(manager.store().open(statePath(), Capacity));
+
+    const QList<ResourceClient*> restored = manager.restoreClients({ QStringLiteral(":1.6") });
+    QCOMPARE(restored.size(), 1);
+    QCOMPARE(restored.first()->clientID(), 2u);
+    QCOMPARE(manager.ownedResources(), Bit::Vibra);
+
+    // the vanished peer's entry is gone for the next restart as well
+    const QList<OwnershipStore::Entry> entries = manager.store().entries();
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries.first().id, 2u);
+}
+
+/* a resource recorded for two exclusive holders stays with the first */
+void TestOwnershipStore::doubleClaim()
+{
+    write({ entry(1, QStringLiteral(":1.5"), Bit::AudioPlayback),
+        entry(2, QStringLiteral(":1.6"), Bit::AudioPlayback | Bit::Vibra) });
+
+    ResourceManager manager;
+    QVERIFY(manager.store().open(statePath(), Capacity));
+    record(manager);
+
+    const QList<ResourceClient*> restored = manager.restoreClients({ QStringLiteral(":1.5"), QStringLiteral(":1.6") });
+    QCOMPARE(restored.size(), 2);
+    QCOMPARE(manager.clientById(1)->resources(), Bit::AudioPlayback);
+    QCOMPARE(manager.clientById(2)->resources(), Bit::Vibra);
+    QCOMPARE(manager.ownerCount(ResourcePolicy::Atom::AudioPlayback), 1);
+
+    // the second set is told what it lost
+    QCOMPARE(m_notifications, (QList<Notification> { { manager.clientById(2), ResourceClient::Lost, Bit::AudioPlayback } }));
+
+    QCOMPARE(manager.store().entries().at(1).granted, Bit::Vibra);
+}
+
+/* names are kept to 48 bytes, a cut one matches no live peer */
+void TestOwnershipStore::truncatedService()
+{
+    const QString service = QStringLiteral("org.example.").append(QString(60, QLatin1Char('a')));
+    write({ entry(1, service, Bit::AudioPlayback) });
+
+    ResourceManager manager;
+    QVERIFY(manager.store().open(statePath(), Capacity));
+
+    const QList<OwnershipStore::Entry> entries = manager.store().entries();
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries.first().service, service.left(48));
+
+    QVERIFY(manager.restoreClients({ service }).isEmpty());
+    QCOMPARE(manager.ownedResources(), ResourceMask(0));
+    QVERIFY(manager.store().entries().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestOwnershipStore)
+#include "test_ownershipstore.moc"
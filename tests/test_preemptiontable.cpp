@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * [PreemptionRules] compiled into the class decision table.
+ */
+
+#include "core/resourcetypes.h"
+#include "policy/preemptiontable.h"
+#include "util/config.h"
+
+#include <QRegularExpression>
+#include <QTemporaryFile>
+#include <QtTest>
+
+namespace {
+
+namespace Bit = ResourcePolicy::Bit;
+using ResourcePolicy::ResourceMask;
+
+constexpr ResourceMask All = ~ResourceMask(0);
+
+} // namespace
+
+class TestPreemptionTable : public QObject {
+    Q_OBJECT
+
+private slots:
+    void wildcards();
+    void emptyResources();
+    void parsedRules();
+    void tooManyClasses();
+};
+
+/* the more specific rule of a pair wins, "*" covers unclassified clients too */
+void TestPreemptionTable::wildcards()
+{
+    const PreemptionTable table = PreemptionTable::compile({
+        { QStringLiteral("call"), QStringLiteral("*"), All },
+        { QStringLiteral("alarm"), QStringLiteral("player"), Bit::AudioPlayback },
+        { QStringLiteral("*"), QStringLiteral("player"), Bit::Vibra },
+    });
+
+    const auto call = table.classId(QStringLiteral("call"));
+    const auto alarm = table.classId(QStringLiteral("alarm"));
+    const auto player = table.classId(QStringLiteral("player"));
+    QCOMPARE(table.classCount(), 4);
+    QVERIFY(call != PreemptionTable::Unclassified);
+    QCOMPARE(table.classId(QStringLiteral("navigator")), PreemptionTable::Unclassified);
+
+    QCOMPARE(table.decide(call, alarm, Bit::AudioPlayback | Bit::Leds), PreemptionTable::Allow);
+    QCOMPARE(table.decide(call, PreemptionTable::Unclassified, Bit::AudioPlayback), PreemptionTable::Allow);
+
+    QCOMPARE(table.decide(alarm, player, Bit::AudioPlayback), PreemptionTable::Allow);
+    QCOMPARE(table.decide(alarm, player, Bit::Vibra), PreemptionTable::Deny);
+    QCOMPARE(table.decide(PreemptionTable::Unclassified, player, Bit::Vibra), PreemptionTable::Allow);
+    QCOMPARE(table.decide(PreemptionTable::Unclassified, player, Bit::AudioPlayback), PreemptionTable::Deny);
+
+    QCOMPARE(table.decide(alarm, call, Bit::AudioPlayback), PreemptionTable::NoRule);
+    QCOMPARE(table.decide(PreemptionTable::Unclassified, PreemptionTable::Unclassified, Bit::AudioPlayback), PreemptionTable::NoRule);
+}
+
+/* an empty right-hand side forbids the pair instead of falling back to priorities */
+void TestPreemptionTable::emptyResources()
+{
+    const PreemptionTable table = PreemptionTable::compile({
+        { QStringLiteral("player"), QStringLiteral("call"), 0 },
+    });
+
+    const auto player = table.classId(QStringLiteral("player"));
+    const auto call = table.classId(QStringLiteral("call"));
+    QCOMPARE(table.decide(player, call, Bit::AudioPlayback), PreemptionTable::Deny);
+    QCOMPARE(table.decide(call, player, Bit::AudioPlayback), PreemptionTable::NoRule);
+}
+
+/* the same through resourced.conf */
+void TestPreemptionTable::parsedRules()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write("[PreemptionRules]\n"
+               "call>*=*\n"
+               "alarm>player=AudioPlayback,Vibra\n"
+               "player>call=\n");
+    file.close();
+
+    Config config;
+    QVERIFY(config.load(file.fileName()));
+    const PreemptionTable& table = config.snapshot()->preemptionRules;
+
+    const auto call = table.classId(QStringLiteral("call"));
+    const auto alarm = table.classId(QStringLiteral("alarm"));
+    const auto player = table.classId(QStringLiteral("player"));
+    QCOMPARE(table.decide(call, player, Bit::AudioPlayback | Bit::VideoPlayback), PreemptionTable::Allow);
+    QCOMPARE(table.decide(alarm, player, Bit::AudioPlayback | Bit::Vibra), PreemptionTable::Allow);
+    QCOMPARE(table.decide(alarm, player, Bit::Leds), PreemptionTable::Deny);
+    QCOMPARE(table.decide(player, call, Bit::AudioPlayback), PreemptionTable::Deny);
+}
+
+/* MaxClasses named classes fit, further ones count as unclassified */
+void TestPreemptionTable::tooManyClasses()
+{
+    QList<PreemptionTable::Rule> rules;
+    for (int i = 0; i <= PreemptionTable::MaxClasses; ++i)
+        rules.append({ QStringLiteral("c%1").arg(i), QStringLiteral("*"), Bit::AudioPlayback });
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("Too many classes, ignoring .*c64")));
+    const PreemptionTable table = PreemptionTable::compile(rules);
+
+    QCOMPARE(table.classCount(), PreemptionTable::MaxClasses + 1);
+    const auto last = table.classId(QStringLiteral("c%1").arg(PreemptionTable::MaxClasses - 1));
+    QVERIFY(last != PreemptionTable::Unclassified);
+    QCOMPARE(table.decide(last, PreemptionTable::Unclassified, Bit::AudioPlayback), PreemptionTable::Allow);
+    QCOMPARE(table.classId(QStringLiteral("c%1").arg(PreemptionTable::MaxClasses)), PreemptionTable::Unclassified);
+}
+
+QTEST_GUILESS_MAIN(TestPreemptionTable)
+#include "test_preemptiontable.moc"
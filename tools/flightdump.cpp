@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Print the flight recorder ring of resourced, oldest event first.
+ * Works on the live file as well as on one left behind by a crash.
+ */
+
+#include "core/resourcetypes.h"
+#include "util/flightrecorder.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("resourced-flightdump");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Decode the resourced flight recorder"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("file"), QStringLiteral("Flight recorder file"), QStringLiteral("[file]"));
+    QCommandLineOption lastOption(QStringLiteral("last"), QStringLiteral("Only print the last <n> events."), QStringLiteral("n"));
+    parser.addOption(lastOption);
+    parser.process(app);
+
+    const QString path = parser.positionalArguments().value(0, QStringLiteral("/run/resourced/flightrecorder"));
+
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || ::fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(FlightRecorder::Header)) {
+        std::fprintf(stderr, "%s: cannot read\n", qPrintable(path));
+        return 1;
+    }
+
+    const std::size_t size = std::size_t(info.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s: cannot map\n", qPrintable(path));
+        return 1;
+    }
+
+    const auto* header = static_cast<const FlightRecorder::Header*>(mapping);
+    if (std::memcmp(header->magic, FlightRecorder::Magic, sizeof(FlightRecorder::Magic)) != 0
+        || header->version != FlightRecorder::Version
+        || header->recordSize != sizeof(FlightRecorder::Record)
+        || sizeof(FlightRecorder::Header) + std::size_t(header->capacity) * sizeof(FlightRecorder::Record) > size) {
+        std::fprintf(stderr, "%s: not a version %u flight recorder\n", qPrintable(path), FlightRecorder::Version);
+        return 1;
+    }
+
+    const auto* records = reinterpret_cast<const FlightRecorder::Record*>(
+        static_cast<const char*>(mapping) + sizeof(FlightRecorder::Header));
+    const quint64 capacity = header->capacity;
+    const quint64 head = header->head.load(std::memory_order_acquire);
+
+    quint64 first = head > capacity ? head - capacity : 0;
+    if (parser.isSet(lastOption))
+        first = std::max(first, head - std::min(head, parser.value(lastOption).toULongLong()));
+
+    for (quint64 number = first; number < head; ++number) {
+        const FlightRecorder::Record& slot = records[number & (capacity - 1)];
+
+        // overwritten or still being written
+        const quint32 sequence = quint32(number) + 1;
+        if (slot.sequence.load(std::memory_order_acquire) != sequence)
+            continue;
+
+        // copy the payload, then make sure the daemon did not start on the
+        // slot meanwhile
+        struct {
+            quint64 timestamp;
+            quint8 event;
+            quint32 client;
+            quint32 other;
+            quint32 reqno;
+            quint32 resources;
+        } record = { slot.timestamp, slot.event, slot.client, slot.other, slot.reqno, slot.resources };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        const QDateTime time = QDateTime::fromMSecsSinceEpoch(qint64(record.timestamp / 1000000));
+        std::printf("%s%06u %-10s client %u reqno %u resources 0x%04x",
+            qPrintable(time.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz"))),
+            unsigned(record.timestamp % 1000000),
+            FlightRecorder::eventName(record.event),
+            record.client,
+            record.reqno,
+            record.resources);
+
+        if (record.event == FlightRecorder::Start)
+            std::printf(" (pid %u)", record.client);
+        else if (record.resources)
+            std::printf(" [%s]", qPrintable(ResourcePolicy::resourceNames(record.resources).join(QLatin1Char(','))));
+
+        if (record.event == FlightRecorder::Preempt)
+            std::printf(" by client %u", record.other);
+
+        std::printf("\n");
+    }
+
+    ::munmap(mapping, size);
+    return 0;
+}
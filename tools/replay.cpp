@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2026 Chupligin Sergey <neochapay@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Feed a traffic trace recorded with resourced --record into the
+ * arbitration core, as fast as possible or at recorded speed, check that
+ * the same notifications come out and report the time spent per call.
+ */
+
+#include "core/resourceclient.h"
+#include "core/resourcemanager.h"
+#include "util/config.h"
+#include "util/statistics.h"
+#include "util/traffictrace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
+#include <QTimer>
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+
+namespace {
+
+struct Notification {
+    uint id; // as recorded
+    quint8 event;
+    ResourcePolicy::ResourceMask resources;
+
+    bool operator==(const Notification& other) const = default;
+};
+
+const char* const EventNames[] = { "granted", "lost", "denied" };
+
+void printNotification(const char* label, const Notification& notification)
+{
+    std::printf("  %s: client %u %s 0x%x\n", label, notification.id,
+        notification.event < 3 ? EventNames[notification.event] : "?", notification.resources);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("resourced-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replay a resourced traffic trace against the arbitration core"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("trace"), QStringLiteral("Trace written by resourced --record"));
+    QCommandLineOption configOption(QStringLiteral("config"),
+        QStringLiteral("Configuration the trace was recorded with."), QStringLiteral("file"));
+    parser.addOption(configOption);
+    QCommandLineOption realtimeOption(QStringLiteral("realtime"),
+        QStringLiteral("Keep the recorded pace instead of replaying as fast as possible. "
+                       "Needed to reproduce damping (MinHoldTime, PairPreemptionLimit), up to timer precision."));
+    parser.addOption(realtimeOption);
+    QCommandLineOption mismatchesOption(QStringLiteral("mismatches"),
+        QStringLiteral("Print at most <n> differing notifications, default 10."), QStringLiteral("n"), QStringLiteral("10"));
+    parser.addOption(mismatchesOption);
+    parser.process(app);
+
+    const QString path = parser.positionalArguments().value(0);
+    TrafficTrace::Reader reader;
+    if (path.isEmpty() || !reader.open(path)) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(path), qPrintable(reader.errorString()));
+        return 1;
+    }
+
+    ResourceManager manager;
+    if (parser.isSet(configOption) && !manager.config()->load(parser.value(configOption))) {
+        std::fprintf(stderr, "%s: cannot load\n", qPrintable(parser.value(configOption)));
+        return 1;
+    }
+
+    // recorded id → replayed client and back, the ids need not match
+    QHash<uint, ResourceClient*> clients;
+    QHash<uint, uint> recordedIds;
+    ResourceClient* registering = nullptr;
+
+    std::deque<Notification> produced;
+    QObject::connect(&manager, &ResourceManager::clientNotified, &manager,
+        [&](ResourceClient* client, ResourceClient::Event event, ResourcePolicy::ResourceMask resources) {
+            produced.push_back({ recordedIds.value(client->clientID(), 0), quint8(event), resources });
+        });
+
+    const int maxMismatches = parser.value(mismatchesOption).toInt();
+    const bool realtime = parser.isSet(realtimeOption);
+    quint64 calls = 0;
+    quint64 notifications = 0;
+    quint64 mismatches = 0;
+    quint64 unknown = 0;
+    quint64 clientCalls = 0;
+
+    auto mismatch = [&](const Notification* expected, const Notification* got) {
+        if (++mismatches > quint64(maxMismatches))
+            return;
+        std::printf("mismatch #%llu\n", mismatches);
+        if (expected)
+            printNotification("recorded", *expected);
+        if (got)
+            printNotification("replayed", *got);
+    };
+
+    QElapsedTimer clock;
+    clock.start();
+
+    TrafficTrace::Entry entry;
+    while (reader.next(entry)) {
+        // damped requests are decided again from a timer, so wait and
+        // replay with the event loop running
+        if (realtime) {
+            const qint64 ahead = qint64(entry.nsecs) - clock.nsecsElapsed();
+            if (ahead > 0) {
+                QEventLoop wait;
+                QTimer::singleShot(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::nanoseconds(ahead)), Qt::PreciseTimer, &wait, &QEventLoop::quit);
+                wait.exec();
+            }
+        }
+        QCoreApplication::processEvents();
+
+        // a register not followed by its id failed in the daemon; client
+        // calls come from the I/O thread and may be written in between
+        if (registering && entry.kind != TrafficTrace::Registered && entry.kind != TrafficTrace::ClientCall) {
+            manager.destroyClient(registering);
+            registering = nullptr;
+        }
+
+        ResourceClient* client = clients.value(entry.id, nullptr);
+
+        switch (entry.kind) {
+        case TrafficTrace::Register: {
+            Statistics::Timer timer(manager.stats(), Statistics::Register);
+            registering = manager.createClient(entry.peer, int(entry.priority));
+            registering->setClientType(entry.type);
+            manager.setClientClass(registering, entry.klass, entry.mode);
+            registering->setResourceSet(entry.mandatory, entry.optional, entry.share, entry.mask);
+            ++calls;
+            break;
+        }
+        case TrafficTrace::Registered:
+            if (registering) {
+                clients.insert(entry.id, registering);
+                recordedIds.insert(registering->clientID(), entry.id);
+                registering = nullptr;
+            }
+            break;
+        case TrafficTrace::Acquire:
+        case TrafficTrace::Release: {
+            ++calls;
+            if (!client) {
+                ++unknown;
+                break;
+            }
+            // other peers' calls are refused before the retry cache is asked
+            if (client->serviceName() != entry.peer)
+                break;
+            // retries are answered without arbitration, as in ManagerAdaptor
+            if (client->isRecentRequest(entry.reqno))
+                break;
+            client->rememberRequest(entry.reqno);
+
+            if (entry.kind == TrafficTrace::Acquire) {
+                Statistics::Timer timer(manager.stats(), Statistics::Acquire);
+                manager.requestResources(client, client->mandatory() | client->optional());
+            } else {
+                Statistics::Timer timer(manager.stats(), Statistics::Release);
+                manager.releaseAll(client);
+            }
+            break;
+        }
+        case TrafficTrace::Unregister: {
+            ++calls;
+            if (!client) {
+                ++unknown;
+                break;
+            }
+            // only the peer that registered a set can drop it
+            if (client->serviceName() != entry.peer)
+                break;
+
+            Statistics::Timer timer(manager.stats(), Statistics::Unregister);
+            recordedIds.remove(client->clientID());
+            clients.remove(entry.id);
+            manager.destroyClient(client);
+            break;
+        }
+        case TrafficTrace::Reap:
+            for (ResourceClient* gone : manager.clientsForService(entry.peer))
+                clients.remove(recordedIds.take(gone->clientID()));
+            manager.destroyClientsForService(entry.peer);
+            break;
+        case TrafficTrace::ClientCall:
+            ++clientCalls;
+            break;
+        case TrafficTrace::Notify: {
+            ++notifications;
+            const Notification expected { entry.id, entry.event, entry.resources };
+            if (produced.empty()) {
+                mismatch(&expected, nullptr);
+            } else {
+                if (produced.front() != expected)
+                    mismatch(&expected, &produced.front());
+                produced.pop_front();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // retries that were due when the recording ended
+    QCoreApplication::processEvents();
+
+    if (!reader.errorString().isEmpty())
+        std::fprintf(stderr, "%s: %s, stopped early\n", qPrintable(path), qPrintable(reader.errorString()));
+
+    for (const Notification& extra : produced)
+        mismatch(nullptr, &extra);
+
+    const qint64 elapsed = clock.nsecsElapsed();
+    std::printf("%llu calls, %llu client calls, %llu notifications in %.3f ms\n",
+        calls, clientCalls, notifications, elapsed / 1e6);
+    for (int i = 0; i < Statistics::MethodCount; ++i) {
+        const auto method = Statistics::Method(i);
+        const LatencyHistogram& histogram = manager.stats().latency(method);
+        if (histogram.count())
+            std::printf("  %-10s %8llu calls, mean %llu ns\n", Statistics::methodName(method),
+                qulonglong(histogram.count()), qulonglong(histogram.total() / histogram.count()));
+    }
+    if (unknown)
+        std::printf("%llu calls for sets registered before the recording started\n", unknown);
+    std::printf("%llu mismatches\n", mismatches);
+
+    return mismatches ? 2 : 0;
+}